@@ -3,17 +3,15 @@
 #include "calc/matrix.hpp"
 
 //! struct BallData
-/*! Defines a moving ball.
+/*! Defines the motion shared by all balls.
  */
 struct BallData {
-    //! Ball sprite index.
+    //! Ball sprite index; the other balls take the following skins.
     unsigned selectedSkin = 0;
-    //! Ball direction.
-    calc::vec3f direction = calc::vec3f(1.0, 1.0, 0);
-    //! Ball speed.
+    //! Number of balls.
+    int count = 1;
+    //! Ball speed, per 1/60 s.
     calc::vec3f speed = calc::vec3f(0, 0, 0);
     //! Ball turn rate.
     calc::vec3f turnRate = calc::vec3f(0, 0, 0);
-    //! Current ball position.
-    calc::mat4f translation = calc::mat4f::identity();
 };
@@ -0,0 +1,298 @@
+#include "ball_system.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+    // Distance from a wall at which balls bounce back
+    constexpr float kHitOffset = 3.0F;
+
+    // Balls stand on the ground, below the grass plane
+    constexpr float kHeight = -1.0F;
+
+    // Frame time the shared speed is given for, ms
+    constexpr float kSpeedFrame = 1000.0F / 60;
+
+    // Longest step, ms; a stall moves the balls no further than this
+    constexpr float kMaxStep = 100.0F;
+
+    // Most skins; bounds the per-skin bookkeeping in submit()
+    constexpr unsigned kMaxSkins = 8;
+
+    // Helper
+    // Moves `count` balls by `speed` x, y along their directions, then
+    // heads those past `bounds` (x min, x max, y min, y max) back inside
+    // and mirrors their overshoot back across the wall.
+    // Selects rather than branches, and the arrays are __restrict, which
+    // GCC only honors on parameters, so the loop vectorizes
+    void move(float* __restrict x,
+              float* __restrict y,
+              float* __restrict dirX,
+              float* __restrict dirY,
+              const float* speed,
+              const float* bounds,
+              unsigned count)
+    {
+        const float speedX = speed[0];
+        const float speedY = speed[1];
+        const float loX = bounds[0];
+        const float hiX = bounds[1];
+        const float loY = bounds[2];
+        const float hiY = bounds[3];
+
+        unsigned i = 0;
+        for (; i != count; ++i) {
+            x[i] += speedX * dirX[i];
+            y[i] += speedY * dirY[i];
+
+            const float absX = std::abs(dirX[i]);
+            const float absY = std::abs(dirY[i]);
+            dirX[i] = x[i] < loX ? absX : (x[i] > hiX ? -absX : dirX[i]);
+            dirY[i] = y[i] < loY ? absY : (y[i] > hiY ? -absY : dirY[i]);
+
+            x[i] = x[i] < loX ? 2 * loX - x[i]
+                              : (x[i] > hiX ? 2 * hiX - x[i] : x[i]);
+            y[i] = y[i] < loY ? 2 * loY - y[i]
+                              : (y[i] > hiY ? 2 * hiY - y[i] : y[i]);
+        }
+    }
+
+    // Helper
+    // Spins `count` unit quaternions by `rate` x, y, z, already scaled by
+    // dt / 2, times their turn rates. Same first-order step as
+    // calc::integrate(), q += (omega dt / 2, 0) * q, then renormalized;
+    // vectorizes only without errno from sqrt, see CMakeLists.txt
+    void spin(float* __restrict qx,
+              float* __restrict qy,
+              float* __restrict qz,
+              float* __restrict qw,
+              const float* __restrict turnX,
+              const float* __restrict turnY,
+              const float* __restrict turnZ,
+              const float* rate,
+              unsigned count)
+    {
+        const float rateX = rate[0];
+        const float rateY = rate[1];
+        const float rateZ = rate[2];
+
+        unsigned i = 0;
+        for (; i != count; ++i) {
+            const float px = rateX * turnX[i];
+            const float py = rateY * turnY[i];
+            const float pz = rateZ * turnZ[i];
+
+            const float x0 = qx[i] + px * qw[i] + py * qz[i] - pz * qy[i];
+            const float y0 = qy[i] - px * qz[i] + py * qw[i] + pz * qx[i];
+            const float z0 = qz[i] + px * qy[i] - py * qx[i] + pz * qw[i];
+            const float w0 = qw[i] - px * qx[i] - py * qy[i] - pz * qz[i];
+
+            const float inverse
+                = 1 / std::sqrt(x0 * x0 + y0 * y0 + z0 * z0 + w0 * w0);
+            qx[i] = x0 * inverse;
+            qy[i] = y0 * inverse;
+            qz[i] = z0 * inverse;
+            qw[i] = w0 * inverse;
+        }
+    }
+} // namespace
+
+BallSystem::BallSystem(unsigned skinCount)
+    : skinCount_(skinCount)
+{
+    /*ASSERT*/ assert(skinCount != 0 && skinCount <= kMaxSkins);
+
+    resize(1, 0, 0);
+}
+
+BallData& BallSystem::controls()
+{
+    return controls_;
+}
+
+unsigned BallSystem::size() const
+{
+    return x_.size();
+}
+
+void BallSystem::reset()
+{
+    controls_.speed = calc::vec3f(0, 0, 0);
+    controls_.turnRate = calc::vec3f(0, 0, 0);
+
+    unsigned i = 0;
+    for (; i != size(); ++i)
+        spawn(i);
+}
+
+void BallSystem::step(float dt, float halfWidth, float halfLength)
+{
+    const unsigned count = unsigned(std::max(controls_.count, 1));
+    if (count != size())
+        resize(count, halfWidth, halfLength);
+
+    dt = std::min(dt, kMaxStep);
+
+    const float speed[] = {controls_.speed[0] * (dt / kSpeedFrame),
+                           controls_.speed[1] * (dt / kSpeedFrame)};
+    const float bounds[] = {kHitOffset - halfWidth,
+                            halfWidth - kHitOffset,
+                            kHitOffset - halfLength,
+                            halfLength - kHitOffset};
+    move(x_.data(),
+         y_.data(),
+         dirX_.data(),
+         dirY_.data(),
+         speed,
+         bounds,
+         count);
+
+    // Turn rates are in tenths of a degree per ms
+    const float h = dt / 2 * calc::radians(0.1F);
+    const float rate[] = {controls_.turnRate[0] * h,
+                          controls_.turnRate[1] * h,
+                          controls_.turnRate[2] * h};
+    spin(qx_.data(),
+         qy_.data(),
+         qz_.data(),
+         qw_.data(),
+         turnX_.data(),
+         turnY_.data(),
+         turnZ_.data(),
+         rate,
+         count);
+}
+
+void BallSystem::submit(render::queue& refqueue,
+                        const calc::mat4f_cm& lookAt,
+                        render::Box* skins,
+                        Program& refprogram)
+{
+    const unsigned count = size();
+
+    // Balls per skin, then where each skin's matrices start
+    unsigned first[kMaxSkins + 1] = {};
+    unsigned i = 0;
+    for (; i != count; ++i)
+        ++first[(skin_[i] + controls_.selectedSkin) % skinCount_ + 1];
+    for (i = 0; i != skinCount_; ++i)
+        first[i + 1] += first[i];
+
+    // Rotation then translation, column-major; summed positions per skin
+    // for the draw order depth
+    matrices_.resize(16 * count);
+    unsigned next[kMaxSkins];
+    float sumX[kMaxSkins] = {};
+    float sumY[kMaxSkins] = {};
+    std::copy(first, first + skinCount_, next);
+
+    for (i = 0; i != count; ++i) {
+        const unsigned s = (skin_[i] + controls_.selectedSkin) % skinCount_;
+        sumX[s] += x_[i];
+        sumY[s] += y_[i];
+
+        const float x = qx_[i];
+        const float y = qy_[i];
+        const float z = qz_[i];
+        const float w = qw_[i];
+
+        float* mat = matrices_.data() + 16 * next[s]++;
+        mat[0] = 1 - 2 * (y * y + z * z);
+        mat[1] = 2 * (x * y + w * z);
+        mat[2] = 2 * (x * z - w * y);
+        mat[3] = 0;
+        mat[4] = 2 * (x * y - w * z);
+        mat[5] = 1 - 2 * (x * x + z * z);
+        mat[6] = 2 * (y * z + w * x);
+        mat[7] = 0;
+        mat[8] = 2 * (x * z + w * y);
+        mat[9] = 2 * (y * z - w * x);
+        mat[10] = 1 - 2 * (x * x + y * y);
+        mat[11] = 0;
+        mat[12] = x_[i];
+        mat[13] = y_[i];
+        mat[14] = kHeight;
+        mat[15] = 1;
+    }
+
+    for (i = 0; i != skinCount_; ++i) {
+        const unsigned n = first[i + 1] - first[i];
+        if (n == 0)
+            continue;
+
+        render::Box& refobject = skins[i];
+        render::pack(refobject.format(),
+                     matrices_.data() + 16 * first[i],
+                     n,
+                     refobject.stream(n));
+
+        // View distance of the skin's mean position
+        const float x = sumX[i] / n;
+        const float y = sumY[i] / n;
+        const float depth = -(lookAt(2, 0) * x + lookAt(2, 1) * y
+                              + lookAt(2, 2) * kHeight + lookAt(2, 3));
+        render::submit(refqueue, refobject, refprogram, depth);
+    }
+}
+
+void BallSystem::resize(unsigned count, float halfWidth, float halfLength)
+{
+    const unsigned old = size();
+
+    spawnX_.resize(count);
+    spawnY_.resize(count);
+    spawnDirX_.resize(count);
+    spawnDirY_.resize(count);
+    x_.resize(count);
+    y_.resize(count);
+    dirX_.resize(count);
+    dirY_.resize(count);
+    turnX_.resize(count);
+    turnY_.resize(count);
+    turnZ_.resize(count);
+    qx_.resize(count);
+    qy_.resize(count);
+    qz_.resize(count);
+    qw_.resize(count);
+    skin_.resize(count);
+
+    // The first ball starts at the center heading diagonally, turning at
+    // the shared rate; the others get random points, headings of the same
+    // speed and turn rates within half of it
+    const float extentX = std::max(halfWidth - kHitOffset, 0.0F);
+    const float extentY = std::max(halfLength - kHitOffset, 0.0F);
+    std::uniform_real_distribution<float> unit(-1, 1);
+
+    unsigned i = old;
+    for (; i != count; ++i) {
+        if (i == 0) {
+            spawnX_[i] = spawnY_[i] = 0;
+            spawnDirX_[i] = spawnDirY_[i] = 1;
+            turnX_[i] = turnY_[i] = turnZ_[i] = 1;
+        } else {
+            spawnX_[i] = extentX * unit(random_);
+            spawnY_[i] = extentY * unit(random_);
+
+            const float angle = calc::radians(180.0F) * unit(random_);
+            spawnDirX_[i] = std::sqrt(2.0F) * std::cos(angle);
+            spawnDirY_[i] = std::sqrt(2.0F) * std::sin(angle);
+
+            turnX_[i] = 1 + unit(random_) / 2;
+            turnY_[i] = 1 + unit(random_) / 2;
+            turnZ_[i] = 1 + unit(random_) / 2;
+        }
+        skin_[i] = i % skinCount_;
+        spawn(i);
+    }
+}
+
+void BallSystem::spawn(unsigned i)
+{
+    x_[i] = spawnX_[i];
+    y_[i] = spawnY_[i];
+    dirX_[i] = spawnDirX_[i];
+    dirY_[i] = spawnDirY_[i];
+    qx_[i] = qy_[i] = qz_[i] = 0;
+    qw_[i] = 1;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ball_data.hpp"
+#include "box.hpp"
+#include "calc/matrix.hpp"
+#include "program.hpp"
+#include "render_queue.hpp"
+#include <random>
+#include <vector>
+
+//! class BallSystem
+/*! Bouncing balls in structure-of-arrays layout, one array per component,
+ *! so that the per-frame step runs as straight loops over floats the
+ *! compiler vectorizes. The control panel sets the motion shared by all
+ *! balls through controls(); each ball scales it by its own direction and
+ *! turn rate. Balls are drawn through one instanced box per skin.
+ */
+class BallSystem {
+public:
+    //! Ctor.
+    //! @param skinCount
+    //!     # of skins the balls cycle through
+    explicit BallSystem(unsigned skinCount);
+
+    //! @return
+    //!     Motion shared by all balls; a new count takes effect on the next
+    //!     step()
+    BallData& controls();
+
+    //! @return
+    //!     # of balls
+    unsigned size() const;
+
+    //! Stops the balls and puts them back where they spawned, unrotated
+    void reset();
+
+    //! Moves and spins the balls over `dt`, bouncing them off the cage
+    //! walls
+    //! @param dt
+    //!     Time since the previous step, ms; capped at 100 ms so a stall
+    //!     cannot carry balls through the walls
+    //! @param halfWidth, halfLength
+    //!     Half size of the cage
+    void step(float dt, float halfWidth, float halfLength);
+
+    //! Queues every ball, one draw per skin
+    //! @param lookAt
+    //!     View matrix, for the draw order depth
+    //! @param skins
+    //!     Instanced boxes, one per skin
+    void submit(render::queue& refqueue,
+                const calc::mat4f_cm& lookAt,
+                render::Box* skins,
+                Program& refprogram);
+private:
+    //! Adds or drops balls to reach `count`; new balls spawn at random in
+    //! the cage
+    void resize(unsigned count, float halfWidth, float halfLength);
+
+    //! Places ball `i` at its spawn point, unrotated and heading its spawn
+    //! direction
+    void spawn(unsigned i);
+
+    // Shared motion
+    BallData controls_;
+    // # of skins
+    unsigned skinCount_;
+    // Spawn points, directions and turn rates of new balls
+    std::minstd_rand random_;
+
+    // Spawn points and directions
+    std::vector<float> spawnX_, spawnY_;
+    std::vector<float> spawnDirX_, spawnDirY_;
+    // Positions
+    std::vector<float> x_, y_;
+    // Directions; velocities are these times the shared speed
+    std::vector<float> dirX_, dirY_;
+    // Turn rates, relative to the shared turn rate
+    std::vector<float> turnX_, turnY_, turnZ_;
+    // Orientations, unit quaternions
+    std::vector<float> qx_, qy_, qz_, qw_;
+    // Skins, relative to the selected skin
+    std::vector<unsigned> skin_;
+
+    // Column-major model matrices, grouped by skin; rebuilt per submit()
+    std::vector<float> matrices_;
+};
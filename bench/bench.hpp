@@ -0,0 +1,207 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+    //! struct result
+    /*! One reported measurement
+     */
+    struct result {
+        std::string name;
+        double nsPerOp;
+        std::size_t iterations;
+    };
+
+    namespace detail {
+
+        //! @return every result reported so far, in order
+        inline std::vector<result>& results()
+        {
+            static std::vector<result> all;
+            return all;
+        }
+
+        //! @return stream the result rows are printed to; stderr when the
+        //!     JSON goes to stdout
+        inline std::FILE*& rows()
+        {
+            static std::FILE* file = stdout;
+            return file;
+        }
+
+        //! @return operations timed by the last measure() call
+        inline std::size_t& last_iterations()
+        {
+            static std::size_t iterations = 0;
+            return iterations;
+        }
+
+        // Helper
+        // Writes `str` as a JSON string literal
+        inline void write_json_string(std::FILE* file, const char* str)
+        {
+            std::fputc('"', file);
+            for (; *str; ++str) {
+                if (*str == '"' || *str == '\\')
+                    std::fputc('\\', file);
+                std::fputc(*str, file);
+            }
+            std::fputc('"', file);
+        }
+    } // namespace detail
+
+    //! Keeps the compiler from discarding a computed value
+    template <typename T>
+    inline void do_not_optimize(const T& value)
+    {
+        asm volatile("" : : "r"(&value) : "memory");
+    }
+
+    //! @param fn
+    //!     Callable that performs `ops` operations per call
+    //! @param ops
+    //!     Operations per call
+    //! @return
+    //!     Mean nanoseconds per operation, best of several runs
+    template <typename Fn>
+    double measure(Fn&& fn, std::size_t ops)
+    {
+        using clock = std::chrono::steady_clock;
+
+        // Warm up caches and the branch predictor
+        for (unsigned i = 0; i != 64; ++i)
+            fn();
+
+        // Grow the batch until it runs long enough to time reliably
+        std::size_t iterations = 1;
+        for (;;) {
+            const auto t0 = clock::now();
+            for (std::size_t i = 0; i != iterations; ++i)
+                fn();
+            const auto t1 = clock::now();
+
+            if (t1 - t0 >= std::chrono::milliseconds(20))
+                break;
+            iterations *= 2;
+        }
+
+        double best = 0;
+        for (unsigned run = 0; run != 5; ++run) {
+            const auto t0 = clock::now();
+            for (std::size_t i = 0; i != iterations; ++i)
+                fn();
+            const auto t1 = clock::now();
+
+            const double ns
+                = std::chrono::duration<double, std::nano>(t1 - t0).count()
+                  / (iterations * ops);
+            if (run == 0 || ns < best)
+                best = ns;
+        }
+
+        detail::last_iterations() = iterations * ops;
+        return best;
+    }
+
+    //! Prints a single result row and records it for write_json()
+    inline void report(const char* name, double nsPerOp)
+    {
+        std::fprintf(detail::rows(), "%-40s %10.3f ns/op\n", name, nsPerOp);
+        detail::results().push_back(
+            result{name, nsPerOp, detail::last_iterations()});
+    }
+
+    //! Parses the command line, which takes only `--json <path>` or
+    //! `--json=<path>`; call before reporting anything. With "-" for stdout,
+    //! the result rows go to stderr so the JSON stays parseable.
+    //! @param json
+    //!     Path given, or nullptr
+    //! @return
+    //!     false, after printing the usage to stderr, on any other argument
+    inline bool parse_args(int argc, char** argv, const char*& json)
+    {
+        json = nullptr;
+        for (int i = 1; i != argc; ++i) {
+            if (std::strcmp(argv[i], "--json") == 0 && i + 1 != argc) {
+                json = argv[++i];
+            } else if (std::strncmp(argv[i], "--json=", 7) == 0) {
+                json = argv[i] + 7;
+            } else {
+                std::fprintf(stderr,
+                             "Unknown argument %s\nUsage: %s [--json <path>]\n",
+                             argv[i],
+                             argv[0]);
+                return false;
+            }
+        }
+
+        if (json && std::strcmp(json, "-") == 0)
+            detail::rows() = stderr;
+        return true;
+    }
+
+    //! Writes every reported result as Google Benchmark JSON, so runs can be
+    //! diffed with its tools/compare.py
+    //! @param path
+    //!     Output file, "-" for stdout
+    //! @param variant
+    //!     Code path the binary was built for, e.g. "scalar" or "avx2_fma"
+    //! @return
+    //!     false if the file could not be written
+    inline bool write_json(const char* path,
+                           const char* executable,
+                           const char* variant)
+    {
+        std::FILE* file
+            = std::strcmp(path, "-") == 0 ? stdout : std::fopen(path, "w");
+        if (!file)
+            return false;
+
+        char date[32];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%FT%T%z", std::localtime(&now));
+
+        std::fprintf(file, "{\n  \"context\": {\n    \"date\": ");
+        detail::write_json_string(file, date);
+        std::fprintf(file, ",\n    \"executable\": ");
+        detail::write_json_string(file, executable);
+        std::fprintf(file,
+                     ",\n    \"num_cpus\": %u,\n",
+                     std::thread::hardware_concurrency());
+#ifdef __OPTIMIZE__
+        std::fprintf(file, "    \"library_build_type\": \"release\",\n");
+#else
+        std::fprintf(file, "    \"library_build_type\": \"debug\",\n");
+#endif
+        std::fprintf(file, "    \"calc_variant\": ");
+        detail::write_json_string(file, variant);
+        std::fprintf(file, "\n  },\n  \"benchmarks\": [");
+
+        const std::vector<result>& all = detail::results();
+        for (std::size_t i = 0; i != all.size(); ++i) {
+            std::fprintf(file, i ? ",\n    {\"name\": " : "\n    {\"name\": ");
+            detail::write_json_string(file, all[i].name.c_str());
+            std::fprintf(file, ", \"run_name\": ");
+            detail::write_json_string(file, all[i].name.c_str());
+            std::fprintf(file,
+                         ", \"run_type\": \"iteration\", \"repetitions\": 1"
+                         ", \"iterations\": %zu, \"real_time\": %.4f"
+                         ", \"cpu_time\": %.4f, \"time_unit\": \"ns\"}",
+                         all[i].iterations,
+                         all[i].nsPerOp,
+                         all[i].nsPerOp);
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+
+        return file == stdout ? std::fflush(file) == 0
+                              : std::fclose(file) == 0;
+    }
+} // namespace bench
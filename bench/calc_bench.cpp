@@ -0,0 +1,597 @@
+#include "bench/bench.hpp"
+#include "bench/kernels.hpp"
+#include "calc/matrix.hpp"
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+    // # of matrices per batch; small enough to stay cache resident
+    const unsigned kBatch = 256;
+
+    /*! Helper
+     *! @return matrix filled with pseudo-random values
+     */
+    calc::mat4f random_mat4f()
+    {
+        calc::mat4f m;
+        for (unsigned i = 0; i != 16; ++i)
+            calc::data(m)[i] = std::rand() / float(RAND_MAX) - 0.5F;
+        return m;
+    }
+
+    /*! Helper
+     *! Times a raw 4x4 kernel over a batch of products
+     */
+    template <typename Kernel>
+    double run_mat4_kernel(Kernel kernel,
+                           const std::vector<calc::mat4f>& lhs,
+                           const std::vector<calc::mat4f>& rhs,
+                           std::vector<calc::mat4f>& out)
+    {
+        return bench::measure(
+            [&]() {
+                for (unsigned i = 0; i != kBatch; ++i)
+                    kernel(calc::data(lhs[i]),
+                           calc::data(rhs[i]),
+                           calc::data(out[i]));
+                bench::do_not_optimize(out);
+            },
+            kBatch);
+    }
+
+    /*! Benchmarks every mat4 x mat4 code path
+     */
+    void bench_matrix_mul_4x4()
+    {
+        std::vector<calc::mat4f> lhs(kBatch), rhs(kBatch), out(kBatch);
+        for (unsigned i = 0; i != kBatch; ++i) {
+            lhs[i] = random_mat4f();
+            rhs[i] = random_mat4f();
+        }
+
+        bench::report("matrix_mul<4,4,4>/scalar",
+                      run_mat4_kernel(&calc::detail::matrix_mul_4x4_scalar,
+                                      lhs,
+                                      rhs,
+                                      out));
+        bench::report(
+            "matrix_mul<4,4,4>/sse",
+            run_mat4_kernel(&calc::detail::matrix_mul_4x4_sse, lhs, rhs, out));
+
+        if (calc::cpu::has_avx2_fma()) {
+            bench::report("matrix_mul<4,4,4>/avx2_fma",
+                          run_mat4_kernel(&calc::detail::matrix_mul_4x4_fma,
+                                          lhs,
+                                          rhs,
+                                          out));
+        } else {
+            std::fprintf(bench::detail::rows(),
+                         "%-40s %10s\n",
+                         "matrix_mul<4,4,4>/avx2_fma",
+                         "n/a");
+        }
+
+        bench::report("matrix_mul<4,4,4>/dispatch",
+                      run_mat4_kernel(&calc::matrix_mul<float, 4, 4, 4>::mul,
+                                      lhs,
+                                      rhs,
+                                      out));
+    }
+
+    /*! Benchmarks calc::batch against per-object products
+     */
+    void bench_batch()
+    {
+        // Large enough to spill out of L1/L2, like a tile field
+        const unsigned count = 100000;
+
+        const calc::mat4f m = random_mat4f();
+        std::vector<calc::mat4f> in(count), out(count);
+        for (unsigned i = 0; i != count; ++i)
+            in[i] = random_mat4f();
+
+        bench::report("mat4 array/operator*",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != count; ++i)
+                                  out[i] = m * in[i];
+                              bench::do_not_optimize(out);
+                          },
+                          count));
+
+        bench::report("mat4 array/batch::mul",
+                      bench::measure(
+                          [&]() {
+                              calc::batch::mul(m, in.data(), out.data(), count);
+                              bench::do_not_optimize(out);
+                          },
+                          count));
+
+        std::vector<float> x(count), y(count), z(count), w(count);
+        for (unsigned i = 0; i != count; ++i) {
+            x[i] = calc::data(in[i])[0];
+            y[i] = calc::data(in[i])[1];
+            z[i] = calc::data(in[i])[2];
+            w[i] = 1;
+        }
+
+        std::vector<calc::vec4f> vecIn(count), vecOut(count);
+        for (unsigned i = 0; i != count; ++i)
+            vecIn[i] = calc::vec4f(x[i], y[i], z[i], w[i]);
+
+        bench::report("vec4 array/operator*",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != count; ++i)
+                                  vecOut[i] = m * vecIn[i];
+                              bench::do_not_optimize(vecOut);
+                          },
+                          count));
+
+        std::vector<float> ox(count), oy(count), oz(count), ow(count);
+        bench::report(
+            "vec4 soa/batch::transform",
+            bench::measure(
+                [&]() {
+                    calc::batch::transform(
+                        m,
+                        {x.data(), y.data(), z.data(), w.data()},
+                        {ox.data(), oy.data(), oz.data(), ow.data()},
+                        count);
+                    bench::do_not_optimize(ox);
+                },
+                count));
+    }
+
+    /*! Benchmarks the runtime-sized products
+     */
+    void bench_gemm()
+    {
+        const std::size_t sizes[] = {64, 256, 1024};
+        for (const std::size_t n : sizes) {
+            std::vector<float> a(n * n), b(n * n), c(n * n);
+            for (std::size_t i = 0; i != n * n; ++i) {
+                a[i] = std::rand() / float(RAND_MAX) - 0.5F;
+                b[i] = std::rand() / float(RAND_MAX) - 0.5F;
+            }
+
+            char name[64];
+            std::snprintf(name, sizeof(name), "gemm %zux%zu/naive", n, n);
+            if (n <= 256) {
+                bench::report(name,
+                              bench::measure(
+                                  [&]() {
+                                      for (std::size_t i = 0; i != n; ++i) {
+                                          for (std::size_t j = 0; j != n; ++j) {
+                                              float sum = 0;
+                                              for (std::size_t k = 0; k != n; ++k)
+                                                  sum += a[i * n + k] * b[k * n + j];
+                                              c[i * n + j] = sum;
+                                          }
+                                      }
+                                      bench::do_not_optimize(c);
+                                  },
+                                  1));
+            }
+
+            std::snprintf(name, sizeof(name), "gemm %zux%zu/blocked", n, n);
+            bench::report(name,
+                          bench::measure(
+                              [&]() {
+                                  calc::matrix_mul<float, 0, 0, 0>::mul(
+                                      a.data(), b.data(), c.data(), n, n, n, 1);
+                                  bench::do_not_optimize(c);
+                              },
+                              1));
+
+            std::snprintf(name, sizeof(name), "gemm %zux%zu/threaded", n, n);
+            bench::report(name,
+                          bench::measure(
+                              [&]() {
+                                  calc::matrix_mul<float, 0, 0, 0>::mul(
+                                      a.data(), b.data(), c.data(), n, n, n);
+                                  bench::do_not_optimize(c);
+                              },
+                              1));
+        }
+    }
+
+    /*! Benchmarks chained products against calc::compose
+     */
+    void bench_compose()
+    {
+        std::vector<calc::mat4f> m(5 * kBatch), out(kBatch);
+        for (calc::mat4f& x : m)
+            x = random_mat4f();
+
+        bench::report("chain x3/operator*",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i) {
+                                  const calc::mat4f* f = &m[i * 5];
+                                  out[i] = f[0] * f[1] * f[2];
+                              }
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("chain x3/compose",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i) {
+                                  const calc::mat4f* f = &m[i * 5];
+                                  out[i] = calc::compose(f[0], f[1], f[2]);
+                              }
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("chain x5/operator*",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i) {
+                                  const calc::mat4f* f = &m[i * 5];
+                                  out[i] = f[0] * f[1] * f[2] * f[3] * f[4];
+                              }
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("chain x5/compose",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i) {
+                                  const calc::mat4f* f = &m[i * 5];
+                                  out[i] = calc::compose(
+                                      f[0], f[1], f[2], f[3], f[4]);
+                              }
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        // Each chain starts from the previous result, as a transform
+        // hierarchy or a per-frame camera chain would; latency bound
+        calc::mat4f acc = calc::mat4f::identity();
+        bench::report("chain x5 dependent/operator*",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i) {
+                                  const calc::mat4f* f = &m[i * 5];
+                                  acc = acc * f[1] * f[2] * f[3] * f[4];
+                              }
+                              bench::do_not_optimize(acc);
+                          },
+                          kBatch));
+
+        bench::report("chain x5 dependent/compose",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i) {
+                                  const calc::mat4f* f = &m[i * 5];
+                                  acc = calc::compose(
+                                      acc, f[1], f[2], f[3], f[4]);
+                              }
+                              bench::do_not_optimize(acc);
+                          },
+                          kBatch));
+    }
+
+    /*! Benchmarks libm against the vectorized sincos and rotation builder
+     */
+    void bench_sincos()
+    {
+        const unsigned count = 4096;
+
+        std::vector<float> x(count), s(count), c(count);
+        for (unsigned i = 0; i != count; ++i)
+            x[i] = (std::rand() / float(RAND_MAX) - 0.5F) * 20;
+
+        bench::report("sincos/libm",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != count; ++i) {
+                                  s[i] = std::sin(x[i]);
+                                  c[i] = std::cos(x[i]);
+                              }
+                              bench::do_not_optimize(s);
+                              bench::do_not_optimize(c);
+                          },
+                          count));
+
+        bench::report("sincos/batch precise",
+                      bench::measure(
+                          [&]() {
+                              calc::batch::sincos(
+                                  x.data(), s.data(), c.data(), count);
+                              bench::do_not_optimize(s);
+                              bench::do_not_optimize(c);
+                          },
+                          count));
+
+        bench::report(
+            "sincos/batch fast",
+            bench::measure(
+                [&]() {
+                    calc::batch::sincos<calc::sincos_accuracy::fast>(
+                        x.data(), s.data(), c.data(), count);
+                    bench::do_not_optimize(s);
+                    bench::do_not_optimize(c);
+                },
+                count));
+
+        std::vector<calc::mat4f> out(kBatch);
+        bench::report("rotation/rotate_4x*4y*4z",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i)
+                                  out[i] = calc::rotate_4x(x[i])
+                                           * calc::rotate_4y(x[i + 1])
+                                           * calc::rotate_4z(x[i + 2]);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report(
+            "rotation/rotate_euler_4",
+            bench::measure(
+                [&]() {
+                    for (unsigned i = 0; i != kBatch; ++i)
+                        out[i] = calc::rotate_euler_4(x[i], x[i + 1], x[i + 2]);
+                    bench::do_not_optimize(out);
+                },
+                kBatch));
+
+        bench::report("rotation/batch::rotate_euler",
+                      bench::measure(
+                          [&]() {
+                              calc::batch::rotate_euler(x.data(),
+                                                        x.data() + 1,
+                                                        x.data() + 2,
+                                                        calc::data(out[0]),
+                                                        kBatch);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+    }
+
+    /*! Benchmarks per-body orientation updates: Euler matrices against an
+     *! integrated quaternion
+     */
+    void bench_quat()
+    {
+        std::vector<calc::vec3f> rate(kBatch);
+        std::vector<calc::quatf> q(kBatch);
+        std::vector<calc::mat4f> out(kBatch);
+        for (unsigned i = 0; i != kBatch; ++i)
+            rate[i] = calc::vec3f(std::rand() / float(RAND_MAX),
+                                  std::rand() / float(RAND_MAX),
+                                  std::rand() / float(RAND_MAX));
+
+        float t = 0;
+        bench::report("orientation/rotate_4x*4y*4z",
+                      bench::measure(
+                          [&]() {
+                              t += 0.01F;
+                              for (unsigned i = 0; i != kBatch; ++i)
+                                  out[i] = calc::compose(
+                                      calc::rotate_4x(rate[i][0] * t),
+                                      calc::rotate_4y(rate[i][1] * t),
+                                      calc::rotate_4z(rate[i][2] * t));
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("orientation/quatf integrate",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i) {
+                                  q[i] = calc::integrate(q[i], rate[i], 0.01F);
+                                  out[i] = calc::rotate_4(q[i]);
+                              }
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        const calc::quatf a = q[0];
+        const calc::quatf b = q[1];
+        calc::quatf r;
+        bench::report("quatf/slerp",
+                      bench::measure(
+                          [&]() {
+                              r = calc::slerp(a, b, 0.3F);
+                              bench::do_not_optimize(r);
+                          },
+                          1));
+    }
+
+    /*! Benchmarks the 4x4 transposes and column-major device translations.
+     *! At -O3 with AVX-512 the compiler vectorizes the element-wise copy
+     *! across neighboring matrices and it matches calc::transpose; in the
+     *! portable build and at -O2 the in-register kernel is faster
+     */
+    void bench_transpose()
+    {
+        std::vector<calc::mat4f> in(kBatch), out(kBatch);
+        std::vector<calc::mat4f_cm> device(kBatch);
+        for (unsigned i = 0; i != kBatch; ++i)
+            in[i] = random_mat4f();
+
+        // Element-wise copy, the way transpose() used to work
+        bench::report("transpose<4>/scalar",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i)
+                                  for (unsigned r = 0; r != 4; ++r)
+                                      for (unsigned c = 0; c != 4; ++c)
+                                          out[i](c, r) = in[i](r, c);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("transpose<4>/calc::transpose",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i)
+                                  out[i] = calc::transpose(in[i]);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("transpose<4>/mat4f_cm conversion",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i)
+                                  device[i] = calc::mat4f_cm(in[i]);
+                              bench::do_not_optimize(device);
+                          },
+                          kBatch));
+
+        // Device matrices for a field of tiles: translate then transpose,
+        // against writing column-major directly
+        std::vector<float> x(kBatch), y(kBatch), z(kBatch);
+        for (unsigned i = 0; i != kBatch; ++i) {
+            x[i] = in[i](0, 0);
+            y[i] = in[i](0, 1);
+            z[i] = in[i](0, 2);
+        }
+
+        bench::report("device translate/translate+transpose",
+                      bench::measure(
+                          [&]() {
+                              calc::batch::translate(in[0],
+                                                     x.data(),
+                                                     y.data(),
+                                                     z.data(),
+                                                     calc::data(out[0]),
+                                                     kBatch);
+                              calc::batch::transpose(calc::data(out[0]),
+                                                     calc::data(out[0]),
+                                                     kBatch);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("device translate/column_major",
+                      bench::measure(
+                          [&]() {
+                              calc::batch::translate<
+                                  calc::storage::column_major>(
+                                  in[0],
+                                  x.data(),
+                                  y.data(),
+                                  z.data(),
+                                  calc::data(device[0]),
+                                  kBatch);
+                              bench::do_not_optimize(device);
+                          },
+                          kBatch));
+    }
+
+    void bench_inverse()
+    {
+        std::vector<calc::mat4f> in(kBatch), model(kBatch), out(kBatch);
+        for (unsigned i = 0; i != kBatch; ++i) {
+            in[i] = random_mat4f() + calc::mat4f::identity() * 2.0F;
+
+            const calc::mat4f r = random_mat4f();
+            calc::mat4f t = calc::mat4f::identity();
+            t(0, 3) = r(0, 0);
+            t(1, 3) = r(0, 1);
+            t(2, 3) = r(0, 2);
+            model[i] = t * calc::rotate_euler_4(r(1, 0), r(1, 1), r(1, 2));
+        }
+
+        bench::report("inverse/scalar",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i)
+                                  calc::detail::inverse_scalar(
+                                      calc::data(in[i]), calc::data(out[i]));
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("inverse/calc::inverse",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i)
+                                  out[i] = calc::inverse(in[i]);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("inverse/batch::inverse",
+                      bench::measure(
+                          [&]() {
+                              calc::batch::inverse(calc::data(in[0]),
+                                                   calc::data(out[0]),
+                                                   kBatch);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("inverse_affine/scalar",
+                      bench::measure(
+                          [&]() {
+                              for (unsigned i = 0; i != kBatch; ++i)
+                                  calc::detail::inverse_affine_scalar(
+                                      calc::data(model[i]),
+                                      calc::data(out[i]));
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        bench::report("inverse_affine/batch::inverse_affine",
+                      bench::measure(
+                          [&]() {
+                              calc::batch::inverse_affine(calc::data(model[0]),
+                                                          calc::data(out[0]),
+                                                          kBatch);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+
+        // Normal matrices: transpose(inverse(model))
+        bench::report("normal matrix/batch",
+                      bench::measure(
+                          [&]() {
+                              calc::batch::inverse_affine(calc::data(model[0]),
+                                                          calc::data(out[0]),
+                                                          kBatch);
+                              calc::batch::transpose(calc::data(out[0]),
+                                                     calc::data(out[0]),
+                                                     kBatch);
+                              bench::do_not_optimize(out);
+                          },
+                          kBatch));
+    }
+} // namespace
+
+/*! Entry point
+ */
+int main(int argc, char** argv)
+{
+    const char* json = nullptr;
+    if (!bench::parse_args(argc, argv, json))
+        return 2;
+
+    std::srand(1);
+    bench::run_kernels();
+    bench_matrix_mul_4x4();
+    bench_batch();
+    bench_compose();
+    bench_sincos();
+    bench_quat();
+    bench_transpose();
+    bench_inverse();
+    bench_gemm();
+
+    const char* variant = calc::cpu::has_avx2_fma() ? "avx2_fma" : "sse";
+    if (json && !bench::write_json(json, argv[0], variant)) {
+        std::fprintf(stderr, "Cannot write %s\n", json);
+        return 1;
+    }
+
+    return 0;
+}
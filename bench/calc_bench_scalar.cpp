@@ -0,0 +1,18 @@
+#include "bench/kernels.hpp"
+
+int main(int argc, char** argv)
+{
+    const char* json = nullptr;
+    if (!bench::parse_args(argc, argv, json))
+        return 2;
+
+    std::srand(1);
+    bench::run_kernels();
+
+    if (json && !bench::write_json(json, argv[0], "scalar")) {
+        std::fprintf(stderr, "Cannot write %s\n", json);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "bench/bench.hpp"
+#include "calc/matrix.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Size sweep over the calc/simd kernels, through the public Matrix operators.
+// Built into calc_bench and, with __NO_USE_SIMD__, into calc_bench_scalar;
+// both report identical names so their JSON output can be compared directly.
+
+namespace bench {
+
+    namespace kernels {
+
+        // # of floats per operand array; keeps all three arrays within L2
+        const unsigned kFloats = 4096;
+
+        /*! Helper
+         *! @return matrix filled with pseudo-random values in [0.5, 1.5)
+         */
+        template <typename Matrix>
+        Matrix random_matrix()
+        {
+            Matrix m;
+            for (unsigned i = 0; i != m.size(); ++i)
+                calc::data(m)[i] = std::rand() / float(RAND_MAX) + 0.5F;
+            return m;
+        }
+
+        /*! Helper
+         *! Times out[i] = op(lhs[i], rhs[i]) over arrays of matrices
+         */
+        template <typename Lhs, typename Rhs, typename Op>
+        void run(const char* kernel, const char* shape, Op op)
+        {
+            const unsigned count = kFloats / (sizeof(Lhs) / sizeof(float));
+
+            typedef decltype(op(Lhs(), Rhs())) Out;
+            std::vector<Lhs> lhs(count);
+            std::vector<Rhs> rhs(count);
+            std::vector<Out> out(count);
+            for (unsigned i = 0; i != count; ++i) {
+                lhs[i] = random_matrix<Lhs>();
+                rhs[i] = random_matrix<Rhs>();
+            }
+
+            char name[64];
+            std::snprintf(name, sizeof(name), "kernels/%s/%s", kernel, shape);
+            report(name,
+                   measure(
+                       [&]() {
+                           for (unsigned i = 0; i != count; ++i)
+                               out[i] = op(lhs[i], rhs[i]);
+                           do_not_optimize(out);
+                       },
+                       count));
+        }
+
+        /*! Element-wise kernels for one matrix shape
+         */
+        template <unsigned N, unsigned M>
+        void run_elementwise(const char* shape)
+        {
+            typedef calc::Matrix<float, N, M> matrix;
+
+            run<matrix, matrix>(
+                "matrix_add", shape, [](const matrix& a, const matrix& b) {
+                    return a + b;
+                });
+            run<matrix, matrix>(
+                "matrix_sub", shape, [](const matrix& a, const matrix& b) {
+                    return a - b;
+                });
+            run<matrix, matrix>(
+                "scalar_mul", shape, [](const matrix& a, const matrix& b) {
+                    return a * b(0, 0);
+                });
+            run<matrix, matrix>(
+                "scalar_div", shape, [](const matrix& a, const matrix& b) {
+                    return a / b(0, 0);
+                });
+            run<matrix, matrix>(
+                "schur_mul", shape, [](const matrix& a, const matrix& b) {
+                    return calc::schur(a, b);
+                });
+        }
+
+        /*! Matrix and matrix-vector products for one square size
+         */
+        template <unsigned N>
+        void run_mul(const char* shape, const char* vectorShape)
+        {
+            typedef calc::Matrix<float, N, N> matrix;
+            typedef calc::Matrix<float, N, 1> vector;
+
+            run<matrix, matrix>(
+                "matrix_mul", shape, [](const matrix& a, const matrix& b) {
+                    return a * b;
+                });
+            run<matrix, vector>(
+                "matrix_mul",
+                vectorShape,
+                [](const matrix& a, const vector& b) { return a * b; });
+        }
+    } // namespace kernels
+
+    /*! Runs the whole sweep; sizes cover every specialized kernel (2, 3, 4,
+     *! 9 and 16 elements) and the generic loop, including a size that is
+     *! not a multiple of the register width
+     */
+    inline void run_kernels()
+    {
+        kernels::run_elementwise<2, 1>("2x1");
+        kernels::run_elementwise<3, 1>("3x1");
+        kernels::run_elementwise<4, 1>("4x1");
+        kernels::run_elementwise<3, 3>("3x3");
+        kernels::run_elementwise<4, 4>("4x4");
+        kernels::run_elementwise<5, 5>("5x5");
+        kernels::run_elementwise<8, 8>("8x8");
+        kernels::run_elementwise<16, 16>("16x16");
+        kernels::run_elementwise<32, 32>("32x32");
+
+        kernels::run_mul<3>("3x3*3x3", "3x3*3x1");
+        kernels::run_mul<4>("4x4*4x4", "4x4*4x1");
+    }
+} // namespace bench
@@ -18,10 +18,13 @@ namespace render {
         //! @param taoCount
         //!     Size of texture handle array
         //! @param instanceSizeMax
-        //!     The maximum # of instances to allocate
+        //!     The initial # of instances to allocate; grows on demand
+        //! @param format
+        //!     Instance layout on the GPU; must match the drawing program
         Box(const unsigned* taoSrc,
             unsigned taoCount,
-            unsigned instanceSizeMax);
+            unsigned instanceSizeMax,
+            instance_format format = instance_format::mat4);
 
         void draw() const override;
 
@@ -36,6 +39,22 @@ namespace render {
         void push_back(const float* mat) override;
 
         void push_back(const float* mat, unsigned count) override;
+
+        void flush() override;
+
+        const float* instance_data() const override;
+
+        unsigned instance_count() const override;
+
+        void reserve(unsigned count) override;
+
+        instance_format format() const override;
+
+        unsigned vertex_array() const override;
+
+        unsigned texture_key() const override;
+
+        void* stream(unsigned count) override;
     private:
         // Texture handles
         tao tao_;
@@ -0,0 +1,335 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+    //! Where a box lies relative to a query volume
+    enum class overlap { outside, partial, inside };
+
+    // Helper
+    // @return the union of `lhs` and `rhs`
+    render::aabb merge(const render::aabb& lhs, const render::aabb& rhs)
+    {
+        render::aabb out;
+        for (unsigned j = 0; j != 3; ++j) {
+            out.min[j] = std::min(lhs.min[j], rhs.min[j]);
+            out.max[j] = std::max(lhs.max[j], rhs.max[j]);
+        }
+        return out;
+    }
+
+    // Helper
+    // @return where `box` lies relative to the planes of `f`; tests the
+    //     corner furthest along each plane normal, then the nearest one
+    overlap classify(const render::aabb& box, const calc::frustum& f)
+    {
+        overlap out = overlap::inside;
+        for (unsigned p = 0; p != 6; ++p) {
+            const float* plane = f.planes[p];
+
+            float leave = plane[3];
+            float enter = plane[3];
+            for (unsigned j = 0; j != 3; ++j) {
+                const bool positive = plane[j] >= 0;
+                leave += plane[j] * (positive ? box.max[j] : box.min[j]);
+                enter += plane[j] * (positive ? box.min[j] : box.max[j]);
+            }
+
+            if (leave < 0)
+                return overlap::outside;
+            if (enter < 0)
+                out = overlap::partial;
+        }
+        return out;
+    }
+
+    // Helper
+    // @return where `box` lies relative to `query`
+    overlap classify(const render::aabb& box, const render::aabb& query)
+    {
+        overlap out = overlap::inside;
+        for (unsigned j = 0; j != 3; ++j) {
+            if (box.max[j] < query.min[j] || box.min[j] > query.max[j])
+                return overlap::outside;
+            if (box.min[j] < query.min[j] || box.max[j] > query.max[j])
+                out = overlap::partial;
+        }
+        return out;
+    }
+
+    // Helper
+    // @return whether the ray from `origin` with inverse direction
+    //     `inverse` enters `box` before `limit`; the entry in `t`
+    bool slab(const render::aabb& box,
+              const float* origin,
+              const float* inverse,
+              float limit,
+              float& t)
+    {
+        float enter = 0;
+        float leave = limit;
+        for (unsigned j = 0; j != 3; ++j) {
+            float t0 = (box.min[j] - origin[j]) * inverse[j];
+            float t1 = (box.max[j] - origin[j]) * inverse[j];
+            if (t0 > t1)
+                std::swap(t0, t1);
+
+            // NaN from 0 * inf, a ray grazing a slab, keeps the bounds
+            enter = t0 > enter ? t0 : enter;
+            leave = t1 < leave ? t1 : leave;
+            if (enter > leave)
+                return false;
+        }
+        return (t = enter, true);
+    }
+
+    // Helper
+    // @return twice the center of `box` along `axis`; only ever compared
+    float center2(const render::aabb& box, unsigned axis)
+    {
+        return box.min[axis] + box.max[axis];
+    }
+
+    // Helper
+    // Builds the subtree over items [first, first + count) and returns
+    // its root
+    unsigned build_node(render::bvh& reftree,
+                        const render::aabb* boxes,
+                        unsigned first,
+                        unsigned count)
+    {
+        const unsigned index = reftree.nodes.size();
+        reftree.nodes.push_back({{}, first, count, 0});
+
+        // Bounds of the items and of their centers
+        render::aabb bounds = boxes[reftree.items[first]];
+        render::aabb centerBounds;
+        for (unsigned j = 0; j != 3; ++j)
+            centerBounds.min[j] = centerBounds.max[j]
+                = center2(boxes[reftree.items[first]], j);
+
+        unsigned i = first + 1;
+        for (; i != first + count; ++i) {
+            const unsigned item = reftree.items[i];
+            bounds = merge(bounds, boxes[item]);
+            for (unsigned j = 0; j != 3; ++j) {
+                const float c = center2(boxes[item], j);
+                centerBounds.min[j] = std::min(centerBounds.min[j], c);
+                centerBounds.max[j] = std::max(centerBounds.max[j], c);
+            }
+        }
+        reftree.nodes[index].bounds = bounds;
+
+        if (count <= render::bvh::kLeafSize)
+            return index;
+
+        unsigned axis = 0;
+        for (unsigned j = 1; j != 3; ++j) {
+            if (centerBounds.max[j] - centerBounds.min[j]
+                > centerBounds.max[axis] - centerBounds.min[axis])
+                axis = j;
+        }
+
+        const auto begin = reftree.items.begin() + first;
+        std::nth_element(begin,
+                         begin + count / 2,
+                         begin + count,
+                         [&](unsigned lhs, unsigned rhs) {
+                             return center2(boxes[lhs], axis)
+                                    < center2(boxes[rhs], axis);
+                         });
+
+        build_node(reftree, boxes, first, count / 2);
+        const unsigned right = build_node(
+            reftree, boxes, first + count / 2, count - count / 2);
+        reftree.nodes[index].right = right;
+        return index;
+    }
+
+    // Helper
+    // Appends the items under leaf `n` whose boxes overlap `query`
+    // @return false for inner nodes, whose children are visited instead
+    bool test_items(const render::bvh& reftree,
+                    const render::bvh::node& n,
+                    const render::aabb& query,
+                    std::vector<unsigned>& out)
+    {
+        if (n.right != 0)
+            return false;
+
+        unsigned i = n.first;
+        for (; i != n.first + n.count; ++i) {
+            if (classify(reftree.boxes[i], query) != overlap::outside)
+                out.push_back(reftree.items[i]);
+        }
+        return true;
+    }
+
+    // Helper
+    // Appends the items under `n`, at most kBatchSize of them, whose
+    // bounding spheres are not outside `query`
+    // @return false for larger nodes, whose children are visited instead
+    bool test_items(const render::bvh& reftree,
+                    const render::bvh::node& n,
+                    const calc::frustum& query,
+                    std::vector<unsigned>& out)
+    {
+        if (n.count > render::bvh::kBatchSize)
+            return false;
+
+        const calc::batch::soa4<const float> spheres = {
+            reftree.spheres[0].data() + n.first,
+            reftree.spheres[1].data() + n.first,
+            reftree.spheres[2].data() + n.first,
+            reftree.spheres[3].data() + n.first,
+        };
+
+        unsigned visible[render::bvh::kBatchSize];
+        const std::size_t count
+            = calc::batch::cull(query, spheres, visible, n.count);
+
+        std::size_t i = 0;
+        for (; i != count; ++i)
+            out.push_back(reftree.items[n.first + visible[i]]);
+        return true;
+    }
+
+    // Helper
+    // Appends the items under every node that `classify` does not put
+    // outside; the items of nodes only partly inside are tested one by one
+    // once test_items() takes them
+    template <typename Query>
+    void collect(const render::bvh& reftree,
+                 const Query& query,
+                 std::vector<unsigned>& out)
+    {
+        if (reftree.nodes.empty())
+            return;
+
+        unsigned stack[render::bvh::kMaxDepth];
+        unsigned size = 0;
+        stack[size++] = 0;
+
+        while (size != 0) {
+            const unsigned index = stack[--size];
+            const render::bvh::node& n = reftree.nodes[index];
+
+            const overlap o = classify(n.bounds, query);
+            if (o == overlap::outside)
+                continue;
+
+            const unsigned* items = reftree.items.data() + n.first;
+            if (o == overlap::inside) {
+                out.insert(out.end(), items, items + n.count);
+            } else if (!test_items(reftree, n, query, out)) {
+                /*ASSERT*/ assert(size + 2 <= render::bvh::kMaxDepth);
+                stack[size++] = n.right;
+                stack[size++] = index + 1;
+            }
+        }
+    }
+} // namespace
+
+bool render::visible(const aabb& refbox, const calc::frustum& reffrustum)
+{
+    return classify(refbox, reffrustum) != overlap::outside;
+}
+
+void render::build(bvh& reftree, const aabb* boxes, unsigned count)
+{
+    reftree.nodes.clear();
+    reftree.boxes.resize(count);
+    reftree.items.resize(count);
+    for (std::vector<float>& refspheres : reftree.spheres)
+        refspheres.resize(count);
+    if (count == 0)
+        return;
+
+    unsigned i = 0;
+    for (; i != count; ++i)
+        reftree.items[i] = i;
+
+    // Median splits leave over kLeafSize / 2 items per leaf, and a binary
+    // tree has fewer than twice as many nodes as leaves
+    reftree.nodes.reserve(4 * (count / bvh::kLeafSize + 1));
+    build_node(reftree, boxes, 0, count);
+
+    for (i = 0; i != count; ++i) {
+        const aabb& refbox = boxes[reftree.items[i]];
+        reftree.boxes[i] = refbox;
+
+        float radius = 0;
+        for (unsigned j = 0; j != 3; ++j) {
+            const float half = (refbox.max[j] - refbox.min[j]) / 2;
+            reftree.spheres[j][i] = refbox.min[j] + half;
+            radius += half * half;
+        }
+        reftree.spheres[3][i] = std::sqrt(radius);
+    }
+}
+
+void render::query(const bvh& reftree,
+                   const calc::frustum& reffrustum,
+                   std::vector<unsigned>& out)
+{
+    collect(reftree, reffrustum, out);
+}
+
+void render::query(const bvh& reftree,
+                   const aabb& refbox,
+                   std::vector<unsigned>& out)
+{
+    collect(reftree, refbox, out);
+}
+
+bool render::raycast(const bvh& reftree,
+                     const ray& refray,
+                     unsigned& index,
+                     float& distance)
+{
+    if (reftree.nodes.empty())
+        return false;
+
+    const float origin[]
+        = {refray.origin[0], refray.origin[1], refray.origin[2]};
+    const float inverse[] = {1 / refray.direction[0],
+                             1 / refray.direction[1],
+                             1 / refray.direction[2]};
+
+    float best = std::numeric_limits<float>::infinity();
+    bool hit = false;
+
+    unsigned stack[bvh::kMaxDepth];
+    unsigned size = 0;
+    stack[size++] = 0;
+
+    while (size != 0) {
+        const unsigned node = stack[--size];
+        const bvh::node& n = reftree.nodes[node];
+
+        float t = 0;
+        if (!slab(n.bounds, origin, inverse, best, t))
+            continue;
+
+        if (n.right == 0) {
+            unsigned i = n.first;
+            for (; i != n.first + n.count; ++i) {
+                if (slab(reftree.boxes[i], origin, inverse, best, t)) {
+                    best = distance = t;
+                    index = reftree.items[i];
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        /*ASSERT*/ assert(size + 2 <= bvh::kMaxDepth);
+        stack[size++] = n.right;
+        stack[size++] = node + 1;
+    }
+
+    return hit;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "calc/matrix.hpp"
+#include "camera.hpp"
+#include <vector>
+
+namespace render {
+
+    //! struct aabb
+    /*! Axis-aligned box, world space
+     */
+    struct aabb {
+        float min[3];
+        float max[3];
+    };
+
+    //! struct bvh
+    /*! Bounding volume hierarchy over a fixed set of boxes, built once.
+     *! Nodes are stored depth first in one array: a node's left child
+     *! follows it and its right child is at `right`. Every node covers a
+     *! contiguous range of the tree-ordered items, so subtrees entirely
+     *! inside a query are reported without visiting their nodes.
+     */
+    struct bvh {
+        // Most items per leaf
+        static constexpr unsigned kLeafSize = 8;
+        // Subtrees of at most this many items that a frustum only partly
+        // contains are tested item by item in one calc::batch::cull()
+        // call rather than traversed
+        static constexpr unsigned kBatchSize = 64;
+        // Deepest traversal stack; a median split tree over 2^32 items
+        // stays well below
+        static constexpr unsigned kMaxDepth = 64;
+
+        //! struct node
+        struct node {
+            // Union of the item boxes below
+            aabb bounds;
+            // Range of tree-ordered items below
+            unsigned first, count;
+            // Right child; 0 for leaves
+            unsigned right;
+        };
+
+        // Nodes, root first
+        std::vector<node> nodes;
+        // Item boxes in tree order
+        std::vector<aabb> boxes;
+        // Item bounding spheres in tree order: center x, y, z and radius
+        std::vector<float> spheres[4];
+        // Original index of each tree-ordered item
+        std::vector<unsigned> items;
+    };
+
+    /*! @return
+     *!     Whether `refbox` is not entirely outside one of the planes of
+     *!     `reffrustum`
+     */
+    bool visible(const aabb& refbox, const calc::frustum& reffrustum);
+
+    /*! @brief Implementation.
+     *! Builds the tree over `count` boxes, splitting each node at the
+     *! median of the item centers along its longest axis. Reuses the
+     *! arrays of `reftree`, allocating only to grow them; `boxes` must not
+     *! point into them.
+     */
+    void build(bvh& reftree, const aabb* boxes, unsigned count);
+
+    /*! @brief Implementation.
+     *! Appends the index of every box not entirely outside one of the
+     *! planes of `reffrustum` to `out`, in no particular order. Items of
+     *! small subtrees are tested by their bounding spheres, so a few boxes
+     *! just outside may be reported too.
+     */
+    void query(const bvh& reftree,
+               const calc::frustum& reffrustum,
+               std::vector<unsigned>& out);
+
+    /*! @brief Implementation.
+     *! Appends the index of every box overlapping `refbox` to `out`, in no
+     *! particular order
+     */
+    void query(const bvh& reftree,
+               const aabb& refbox,
+               std::vector<unsigned>& out);
+
+    /*! @brief Implementation.
+     *! Finds the box nearest to the origin of `refray` along its direction,
+     *! e.g. under the mouse through Camera::unproject()
+     *! @param index
+     *!     Index of the box hit
+     *! @param distance
+     *!     Ray parameter of the entry point; 0 when the origin is inside
+     *! @return
+     *!     Whether any box is hit
+     */
+    bool raycast(const bvh& reftree,
+                 const ray& refray,
+                 unsigned& index,
+                 float& distance);
+} // namespace render
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "matrix_nxm.hpp"
+#include <cmath>
+
+namespace calc {
+
+    //! struct frustum
+    /*! View frustum as six planes (a, b, c, d) in world space, in the order
+     *! left, right, bottom, top, near, far. Normals are unit length and
+     *! point inward: a x + b y + c z + d is the signed distance of (x, y, z)
+     *! from the plane, negative outside.
+     */
+    struct frustum {
+        float planes[6][4];
+    };
+
+    //! @return
+    //!     Planes of the clip volume of `scene`, a projection x view
+    //!     matrix mapping the visible region to -w <= x, y, z <= w
+    //!     (Gribb-Hartmann)
+    template <storage S>
+    inline frustum frustum_planes(const Matrix<float, 4, 4, S>& scene)
+    {
+        frustum out;
+        for (unsigned i = 0; i != 6; ++i) {
+            // Row 3 plus (even i) or minus (odd i) row i / 2
+            const unsigned row = i / 2;
+            const float sign = (i % 2) ? -1.0F : 1.0F;
+
+            float* plane = out.planes[i];
+            for (unsigned j = 0; j != 4; ++j)
+                plane[j] = scene(3, j) + sign * scene(row, j);
+
+            const float length = std::sqrt(plane[0] * plane[0]
+                                           + plane[1] * plane[1]
+                                           + plane[2] * plane[2]);
+            for (unsigned j = 0; j != 4; ++j)
+                plane[j] /= length;
+        }
+        return out;
+    }
+} // namespace calc
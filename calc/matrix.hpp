@@ -1,5 +1,8 @@
 #pragma once
 
+#include "frustum.hpp"
+#include "matrix_batch.hpp"
 #include "matrix_nxm.hpp"
 #include "matrix_operation.hpp"
 #include "matrix_transform.hpp"
+#include "quaternion.hpp"
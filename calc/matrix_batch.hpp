@@ -0,0 +1,253 @@
+#pragma once
+
+#include "frustum.hpp"
+#include "matrix_nxm.hpp"
+#include "matrix_operation.hpp"
+#include "matrix_transform.hpp"
+#include <cstddef>
+
+#ifndef __NO_USE_SIMD__
+#include "simd/batch.hpp"
+#endif
+
+namespace calc {
+
+    //! Bulk transforms over contiguous arrays of 4x4 matrices and 4-vectors.
+    /*! Matrix arrays are packed row-major floats, 16 per element, the same
+     *! layout as the instance buffers; the calls work in place (in == out).
+     */
+    namespace batch {
+
+        //! struct soa4
+        /*! Structure-of-arrays view over 4-component vectors
+         */
+        template <typename T>
+        struct soa4 {
+            T* x;
+            T* y;
+            T* z;
+            T* w;
+        };
+
+        //! out[i] = lhs * in[i]
+        inline void mul(const mat4f& lhs,
+                        const float* in,
+                        float* out,
+                        std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i)
+                std::memcpy(out + i * 16,
+                            data(lhs * mat4f(in + i * 16)),
+                            16 * sizeof(float));
+#else
+            batch_mul::lhs(data(lhs), in, out, count);
+#endif
+        }
+
+        //! out[i] = in[i] * rhs
+        inline void mul(const float* in,
+                        const mat4f& rhs,
+                        float* out,
+                        std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i)
+                std::memcpy(out + i * 16,
+                            data(mat4f(in + i * 16) * rhs),
+                            16 * sizeof(float));
+#else
+            batch_mul::rhs(in, data(rhs), out, count);
+#endif
+        }
+
+        //! out[i] = m * in[i] over packed xyzw vectors
+        inline void transform(const mat4f& m,
+                              const float* in,
+                              float* out,
+                              std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i)
+                std::memcpy(out + i * 4,
+                            data(m * vec4f(in + i * 4)),
+                            4 * sizeof(float));
+#else
+            batch_transform::aos(data(m), in, out, count);
+#endif
+        }
+
+        //! out = m * in over structure-of-arrays vectors
+        inline void transform(const mat4f& m,
+                              const soa4<const float>& in,
+                              const soa4<float>& out,
+                              std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i) {
+                const vec4f v = m * vec4f(in.x[i], in.y[i], in.z[i], in.w[i]);
+                out.x[i] = v[0];
+                out.y[i] = v[1];
+                out.z[i] = v[2];
+                out.w[i] = v[3];
+            }
+#else
+            const float* const src[] = {in.x, in.y, in.z, in.w};
+            float* const dst[] = {out.x, out.y, out.z, out.w};
+            batch_transform::soa(data(m), src, dst, count);
+#endif
+        }
+
+        //! out[i] = translation(x[i], y[i], z[i]) * model, written in
+        //! storage order S; column-major output goes straight to the device
+        template <storage S = storage::row_major>
+        inline void translate(const mat4f& model,
+                              const float* x,
+                              const float* y,
+                              const float* z,
+                              float* out,
+                              std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i) {
+                mat4f t = mat4f::identity();
+                t(0, 3) = x[i];
+                t(1, 3) = y[i];
+                t(2, 3) = z[i];
+                std::memcpy(out + i * 16,
+                            data(Matrix<float, 4, 4, S>(t * model)),
+                            16 * sizeof(float));
+            }
+#else
+            if constexpr (S == storage::row_major)
+                batch_translate::translate(data(model), x, y, z, out, count);
+            else
+                batch_translate::translate_transposed(
+                    data(model), x, y, z, out, count);
+#endif
+        }
+
+        //! Transposes each matrix, e.g. into column-major device order
+        inline void transpose(const float* in, float* out, std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i)
+                std::memcpy(out + i * 16,
+                            data(calc::transpose(mat4f(in + i * 16))),
+                            16 * sizeof(float));
+#else
+            batch_transpose::transpose(in, out, count);
+#endif
+        }
+
+        //! out[i] = inverse(in[i])
+        inline void inverse(const float* in, float* out, std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i)
+                detail::inverse_scalar(in + i * 16, out + i * 16);
+#else
+            matrix_inverse<float, 4>::inverse(in, out, count);
+#endif
+        }
+
+        //! out[i] = inverse_affine(in[i])
+        inline void inverse_affine(const float* in,
+                                   float* out,
+                                   std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i)
+                detail::inverse_affine_scalar(in + i * 16, out + i * 16);
+#else
+            matrix_inverse<float, 4>::affine(in, out, count);
+#endif
+        }
+
+        //! s[i] = sin(in[i]), c[i] = cos(in[i])
+        template <sincos_accuracy A = sincos_accuracy::precise>
+        inline void sincos(const float* in,
+                           float* s,
+                           float* c,
+                           std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i) {
+                s[i] = std::sin(in[i]);
+                c[i] = std::cos(in[i]);
+            }
+#else
+            simd_sincos<A>::sincos(in, s, c, count);
+#endif
+        }
+
+        //! out[i] = rotate_euler_4(pitch[i], yaw[i], roll[i])
+        template <sincos_accuracy A = sincos_accuracy::precise>
+        inline void rotate_euler(const float* pitch,
+                                 const float* yaw,
+                                 const float* roll,
+                                 float* out,
+                                 std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            for (std::size_t i = 0; i != count; ++i)
+                std::memcpy(out + i * 16,
+                            data(rotate_euler_4(pitch[i], yaw[i], roll[i])),
+                            16 * sizeof(float));
+#else
+            batch_rotate_euler<A>::rotate(pitch, yaw, roll, out, count);
+#endif
+        }
+
+        //! Writes the index of every sphere that is not entirely outside
+        //! one of the planes of `f`; spheres are center x, y, z and radius
+        //! in w
+        //! @return
+        //!     # of indices written to `visible`, in ascending order
+        inline std::size_t cull(const frustum& f,
+                                const soa4<const float>& spheres,
+                                unsigned* visible,
+                                std::size_t count)
+        {
+#ifdef __NO_USE_SIMD__
+            unsigned* out = visible;
+            for (std::size_t i = 0; i != count; ++i) {
+                bool inside = true;
+                for (unsigned p = 0; p != 6 && inside; ++p) {
+                    const float* plane = f.planes[p];
+                    inside = plane[0] * spheres.x[i] + plane[1] * spheres.y[i]
+                                 + plane[2] * spheres.z[i] + plane[3]
+                             >= -spheres.w[i];
+                }
+                if (inside)
+                    *out++ = unsigned(i);
+            }
+            return out - visible;
+#else
+            const float* const src[]
+                = {spheres.x, spheres.y, spheres.z, spheres.w};
+            return batch_cull::cull(f.planes[0], src, visible, count);
+#endif
+        }
+
+        //! Overload
+        inline void mul(const mat4f& lhs,
+                        const mat4f* in,
+                        mat4f* out,
+                        std::size_t count)
+        {
+            static_assert(sizeof(mat4f) == 16 * sizeof(float));
+            mul(lhs, data(*in), data(*out), count);
+        }
+
+        //! Overload
+        inline void mul(const mat4f* in,
+                        const mat4f& rhs,
+                        mat4f* out,
+                        std::size_t count)
+        {
+            static_assert(sizeof(mat4f) == 16 * sizeof(float));
+            mul(data(*in), rhs, data(*out), count);
+        }
+    } // namespace batch
+} // namespace calc
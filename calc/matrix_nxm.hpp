@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstring>
@@ -9,6 +10,7 @@
 #include "simd/matrix_add.hpp"
 #include "simd/matrix_mul.hpp"
 #include "simd/matrix_sub.hpp"
+#include "simd/matrix_transpose.hpp"
 #include "simd/scalar_div.hpp"
 #include "simd/scalar_mul.hpp"
 #endif
@@ -18,63 +20,118 @@
 
 namespace calc {
 
+    //! struct no_init_t
+    /*! Tag selecting the Matrix constructor that skips zero-filling, for
+     *! results that are about to be overwritten in full
+     */
+    struct no_init_t {};
+
+    //! Tag value
+    inline constexpr no_init_t no_init{};
+
+    //! Element storage order
+    enum class storage {
+        // Rows are contiguous; the native order for calc's kernels
+        row_major,
+        // Columns are contiguous; the order OpenGL expects ("device" order)
+        column_major
+    };
+
     //! class Matrix
-    /*! Defines a row-major matrix
+    /*! Defines a matrix, row-major unless S__ says otherwise. Element access
+     *! through operator() is the same for either order; raw-buffer
+     *! constructors and data() expose the storage order
      */
-    template <typename T__, unsigned N__, unsigned M__>
+    template <typename T__,
+              unsigned N__,
+              unsigned M__,
+              storage S__ = storage::row_major>
     class Matrix {
-        // Row-major ordered matrix data
+        // Matrix data, ordered as S__
         T__ buffer_[__padd__(N__ * M__)] __attribute__((aligned(16)));
     public:
-        static Matrix<T__, N__, M__> identity(const T__ eigenout = 1)
+        static constexpr Matrix<T__, N__, M__, S__> identity(
+            const T__ eigenout = 1)
         {
-            Matrix<T__, N__, M__> out(T__(0));
+            Matrix<T__, N__, M__, S__> out(T__(0));
             for (unsigned i = 0; i != N__; ++i)
                 out(i, i) = eigenout;
             return out;
         }
 
-        operator T__*()
+        constexpr operator T__*()
         {
             return buffer_;
         }
 
-        operator const T__*() const
+        constexpr operator const T__*() const
         {
             return buffer_;
         }
 
         //! Ctor.
-        Matrix()
+        constexpr Matrix()
         {
-            std::memset(buffer_, 0, sizeof(buffer_));
+            std::fill_n(buffer_, sizeof(buffer_) / sizeof(T__), T__(0));
         }
 
         //! Ctor.
-        Matrix(const typename std::enable_if<std::is_same<T__, float>::value,
-                                             T__>::type fill)
+        //! Leaves the elements uninitialized; only the alignment padding is
+        //! cleared
+        constexpr explicit Matrix(no_init_t)
         {
+            clear_padding();
+        }
+
+        //! Ctor.
+        constexpr Matrix(
+            const typename std::enable_if<std::is_same<T__, float>::value,
+                                          T__>::type fill)
+        {
+            clear_padding();
             for (unsigned i = 0; i != N__ * M__; ++i) {
                 buffer_[i] = fill;
             }
         }
 
         //! Ctor.
-        Matrix(const T__* fill)
+        //! `fill` is in storage order
+        constexpr Matrix(const T__* fill)
         {
-            std::memset(buffer_, 0, sizeof(buffer_));
-            std::memcpy(buffer_, fill, N__ * M__ * sizeof(float));
+            clear_padding();
+            std::copy_n(fill, N__ * M__, buffer_);
         }
 
         //! Ctor.
-        template <unsigned N1, unsigned M1, unsigned N = N__, unsigned M = M__>
-        Matrix(const Matrix<T__, N1, M1>& v,
-               typename std::enable_if<N * M == 4 && (N == 1 || M == 1)
-                                           && (N1 * M1 == 2),
-                                       T__>::type x2,
-               T__ x3)
+        //! Converts from the other storage order
+        template <storage S1,
+                  typename = typename std::enable_if<S1 != S__>::type>
+        constexpr explicit Matrix(const Matrix<T__, N__, M__, S1>& m)
         {
-            std::memset(buffer_, 0, sizeof(buffer_));
+            clear_padding();
+#ifndef __NO_USE_SIMD__
+            if constexpr (N__ == 4 && M__ == 4 && std::is_same_v<T__, float>) {
+                if (!std::is_constant_evaluated()) {
+                    matrix_transpose<float, 4>::transpose(m, buffer_);
+                    return;
+                }
+            }
+#endif
+            for (unsigned r = 0; r != N__; ++r)
+                for (unsigned c = 0; c != M__; ++c)
+                    (*this)(r, c) = m(r, c);
+        }
+
+        //! Ctor.
+        template <unsigned N1, unsigned M1, unsigned N = N__, unsigned M = M__>
+        constexpr Matrix(
+            const Matrix<T__, N1, M1>& v,
+            typename std::enable_if<N * M == 4 && (N == 1 || M == 1)
+                                        && (N1 * M1 == 2),
+                                    T__>::type x2,
+            T__ x3)
+        {
+            clear_padding();
             buffer_[0] = v[0];
             buffer_[1] = v[1];
             buffer_[2] = x2;
@@ -83,12 +140,13 @@ namespace calc {
 
         //! Ctor.
         template <unsigned N1, unsigned M1, unsigned N = N__, unsigned M = M__>
-        Matrix(const Matrix<T__, N1, M1>& v,
-               typename std::enable_if<N * M == 4 && (N == 1 || M == 1)
-                                           && (N1 * M1 == 3),
-                                       T__>::type x3)
+        constexpr Matrix(
+            const Matrix<T__, N1, M1>& v,
+            typename std::enable_if<N * M == 4 && (N == 1 || M == 1)
+                                        && (N1 * M1 == 3),
+                                    T__>::type x3)
         {
-            std::memset(buffer_, 0, sizeof(buffer_));
+            clear_padding();
             buffer_[0] = v[0];
             buffer_[1] = v[1];
             buffer_[2] = v[2];
@@ -97,28 +155,29 @@ namespace calc {
 
         //! Ctor.
         template <unsigned N = N__, unsigned M = M__>
-        Matrix(typename std::enable_if<N * M == 1, T__>::type x0)
+        constexpr Matrix(typename std::enable_if<N * M == 1, T__>::type x0)
         {
-            std::memset(buffer_, 0, sizeof(buffer_));
+            clear_padding();
             buffer_[0] = x0;
         }
 
         //! Ctor.
         template <unsigned N = N__, unsigned M = M__>
-        Matrix(typename std::enable_if<N * M == 2, T__>::type x0, T__ x1)
+        constexpr Matrix(typename std::enable_if<N * M == 2, T__>::type x0,
+                         T__ x1)
         {
-            std::memset(buffer_, 0, sizeof(buffer_));
+            clear_padding();
             buffer_[0] = x0;
             buffer_[1] = x1;
         }
 
         //! Ctor.
         template <unsigned N = N__, unsigned M = M__>
-        Matrix(typename std::enable_if<N * M == 3, T__>::type x0,
-               T__ x1,
-               T__ x2)
+        constexpr Matrix(typename std::enable_if<N * M == 3, T__>::type x0,
+                         T__ x1,
+                         T__ x2)
         {
-            std::memset(buffer_, 0, sizeof(buffer_));
+            clear_padding();
             buffer_[0] = x0;
             buffer_[1] = x1;
             buffer_[2] = x2;
@@ -126,12 +185,12 @@ namespace calc {
 
         //! Ctor.
         template <unsigned N = N__, unsigned M = M__>
-        Matrix(typename std::enable_if<N * M == 4, T__>::type x0,
-               T__ x1,
-               T__ x2,
-               T__ x3)
+        constexpr Matrix(typename std::enable_if<N * M == 4, T__>::type x0,
+                         T__ x1,
+                         T__ x2,
+                         T__ x3)
         {
-            std::memset(buffer_, 0, sizeof(buffer_));
+            clear_padding();
             buffer_[0] = x0;
             buffer_[1] = x1;
             buffer_[2] = x2;
@@ -140,17 +199,17 @@ namespace calc {
 
         //! Ctor.
         template <unsigned N = N__, unsigned M = M__>
-        Matrix(typename std::enable_if<N * M == 9, T__>::type x0,
-               T__ x1,
-               T__ x2,
-               T__ x3,
-               T__ x4,
-               T__ x5,
-               T__ x6,
-               T__ x7,
-               T__ x8)
-        {
-            std::memset(buffer_, 0, sizeof(buffer_));
+        constexpr Matrix(typename std::enable_if<N * M == 9, T__>::type x0,
+                         T__ x1,
+                         T__ x2,
+                         T__ x3,
+                         T__ x4,
+                         T__ x5,
+                         T__ x6,
+                         T__ x7,
+                         T__ x8)
+        {
+            clear_padding();
             buffer_[0] = x0;
             buffer_[1] = x1;
             buffer_[2] = x2;
@@ -166,24 +225,24 @@ namespace calc {
 
         //! Ctor.
         template <unsigned N = N__, unsigned M = M__>
-        Matrix(typename std::enable_if<N * M == 16, T__>::type x0,
-               T__ x1,
-               T__ x2,
-               T__ x3,
-               T__ x4,
-               T__ x5,
-               T__ x6,
-               T__ x7,
-               T__ x8,
-               T__ x9,
-               T__ x10,
-               T__ x11,
-               T__ x12,
-               T__ x13,
-               T__ x14,
-               T__ x15)
-        {
-            std::memset(buffer_, 0, sizeof(buffer_));
+        constexpr Matrix(typename std::enable_if<N * M == 16, T__>::type x0,
+                         T__ x1,
+                         T__ x2,
+                         T__ x3,
+                         T__ x4,
+                         T__ x5,
+                         T__ x6,
+                         T__ x7,
+                         T__ x8,
+                         T__ x9,
+                         T__ x10,
+                         T__ x11,
+                         T__ x12,
+                         T__ x13,
+                         T__ x14,
+                         T__ x15)
+        {
+            clear_padding();
             buffer_[0] = x0;
             buffer_[1] = x1;
             buffer_[2] = x2;
@@ -205,72 +264,93 @@ namespace calc {
             buffer_[15] = x15;
         }
 
-        unsigned rows() const
+        constexpr unsigned rows() const
         {
             return N__;
         }
 
-        unsigned cols() const
+        constexpr unsigned cols() const
         {
             return M__;
         }
 
-        unsigned size() const
+        constexpr unsigned size() const
         {
             return N__ * M__;
         }
 
         //! Overload
         template <unsigned N = N__, unsigned M = M__>
-        typename std::enable_if<N == 1 || M == 1, T__&>::type operator[](
-            unsigned i)
+        constexpr typename std::enable_if<N == 1 || M == 1, T__&>::type
+        operator[](unsigned i)
         {
             return buffer_[i];
         }
 
         //! Overload
         template <unsigned N = N__, unsigned M = M__>
-        typename std::enable_if<N == 1 || M == 1, const T__&>::type operator[](
-            unsigned i) const
+        constexpr typename std::enable_if<N == 1 || M == 1, const T__&>::type
+        operator[](unsigned i) const
         {
             return buffer_[i];
         }
 
         //! Overload
-        template <unsigned N = N__, unsigned M = M__>
-        typename std::enable_if<(N > 1 && M > 1), T__*>::type operator[](
-            unsigned r)
+        template <unsigned N = N__, unsigned M = M__, storage S = S__>
+        constexpr typename std::enable_if<(N > 1 && M > 1)
+                                              && S == storage::row_major,
+                                          T__*>::type
+        operator[](unsigned r)
         {
             return &buffer_[r * M__];
         }
 
         //! Overload
-        template <unsigned N = N__, unsigned M = M__>
-        typename std::enable_if<(N > 1 && M > 1), const T__*>::type operator[](
-            unsigned r) const
+        template <unsigned N = N__, unsigned M = M__, storage S = S__>
+        constexpr typename std::enable_if<(N > 1 && M > 1)
+                                              && S == storage::row_major,
+                                          const T__*>::type
+        operator[](unsigned r) const
         {
             return &buffer_[r * M__];
         }
 
         //! Overload
-        T__& operator()(const unsigned r, const unsigned c)
+        constexpr T__& operator()(const unsigned r, const unsigned c)
         {
-            return buffer_[r * M__ + c];
+            return buffer_[index(r, c)];
         }
 
         //! Overload
-        const T__& operator()(const unsigned r, const unsigned c) const
+        constexpr const T__& operator()(const unsigned r,
+                                        const unsigned c) const
         {
-            return buffer_[r * M__ + c];
+            return buffer_[index(r, c)];
         }
 
         //! Overload
         template <unsigned M1>
-        Matrix<T__, N__, M1> operator*(const Matrix<T__, M__, M1>& rhs) const
+        constexpr Matrix<T__, N__, M1, S__> operator*(
+            const Matrix<T__, M__, M1, S__>& rhs) const
         {
-#ifdef __NO_USE_SIMD__
-            Matrix<T__, N__, M1> out;
-
+            Matrix<T__, N__, M1, S__> out(no_init);
+#ifndef __NO_USE_SIMD__
+            if (!std::is_constant_evaluated()) {
+                if constexpr (S__ == storage::row_major) {
+                    matrix_mul<T__, N__, M__, M1>::mul(
+                        buffer_, static_cast<const T__*>(rhs), out);
+                    return out;
+                }
+                // Column-major buffers hold the row-major transposes, and
+                // (A * B)' = B' * A'
+                else if constexpr (N__ == M__ && M__ == M1
+                                   && (N__ == 3 || N__ == 4)) {
+                    matrix_mul<T__, N__, N__, N__>::mul(
+                        static_cast<const T__*>(rhs), buffer_, out);
+                    return out;
+                }
+            }
+#endif
             for (unsigned r = 0; r != N__; ++r) {
                 for (unsigned c = 0; c != M1; ++c) {
                     T__ sum = 0;
@@ -283,70 +363,90 @@ namespace calc {
                     out(r, c) = sum;
                 }
             }
-#else
-            Matrix<T__, N__, M1> out;
-            matrix_mul<T__, N__, M__, M1>::mul(buffer_, data(rhs), data(out));
-#endif
+
+            return out;
+        }
+
+        //! Overload
+        //! Column-major matrix times a (storage-independent) column vector
+        template <storage S = S__,
+                  typename = typename std::enable_if<
+                      S == storage::column_major>::type>
+        constexpr Matrix<T__, N__, 1> operator*(
+            const Matrix<T__, M__, 1>& rhs) const
+        {
+            Matrix<T__, N__, 1> out(no_init);
+            for (unsigned r = 0; r != N__; ++r) {
+                T__ sum = 0;
+                for (unsigned i = 0; i != M__; ++i)
+                    sum += (*this)(r, i) * rhs[i];
+                out[r] = sum;
+            }
+
             return out;
         }
 
         //! Overload
-        Matrix<T__, N__, M__> operator*(const T__ scalar) const
+        constexpr Matrix<T__, N__, M__, S__> operator*(const T__ scalar) const
         {
-#ifdef __NO_USE_SIMD__
-            Matrix<T__, N__, M__> out;
+            Matrix<T__, N__, M__, S__> out(no_init);
+#ifndef __NO_USE_SIMD__
+            if (!std::is_constant_evaluated()) {
+                scalar_mul<T__, N__ * M__>::mul(
+                    buffer_, scalar, out.buffer_, size());
+                return out;
+            }
+#endif
             for (unsigned i = 0; i != size(); ++i)
                 out.buffer_[i] = buffer_[i] * scalar;
-#else
-            Matrix<T__, N__, M__> out;
-            scalar_mul<T__, N__ * M__>::mul(
-                buffer_, scalar, out.buffer_, size());
-#endif
             return out;
         }
 
         //! Overload
-        Matrix<T__, N__, M__> operator/(const T__ scalar) const
+        constexpr Matrix<T__, N__, M__, S__> operator/(const T__ scalar) const
         {
-#ifdef __NO_USE_SIMD__
-            Matrix<T__, N__, M__> out;
-            for (unsigned i = 0; i != size(); ++i) {
-                out.buffer_[i] = buffer_[i] / scalar;
+            Matrix<T__, N__, M__, S__> out(no_init);
+#ifndef __NO_USE_SIMD__
+            if (!std::is_constant_evaluated()) {
+                scalar_div<T__, N__ * M__>::div(
+                    buffer_, scalar, out.buffer_, size());
+                return out;
             }
-#else
-            Matrix<T__, N__, M__> out;
-            scalar_div<T__, N__ * M__>::div(
-                buffer_, scalar, out.buffer_, size());
 #endif
+            for (unsigned i = 0; i != size(); ++i)
+                out.buffer_[i] = buffer_[i] / scalar;
             return out;
         }
 
         //! Overload
         template <unsigned M1>
-        Matrix<T__, N__, M1>& operator*=(const Matrix<T__, M__, M1>& rhs)
+        Matrix<T__, N__, M1, S__>& operator*=(
+            const Matrix<T__, M__, M1, S__>& rhs)
         {
-#ifdef __NO_USE_SIMD__
-            return (*this = (*this * rhs));
-#else
-            matrix_mul<T__, N__, M__, M1>::mul(buffer_, data(rhs), buffer_);
-            return *this;
+#ifndef __NO_USE_SIMD__
+            if constexpr (S__ == storage::row_major) {
+                matrix_mul<T__, N__, M__, M1>::mul(
+                    buffer_, static_cast<const T__*>(rhs), buffer_);
+                return *this;
+            }
 #endif
+            return (*this = (*this * rhs));
         }
 
         //! Overload
-        Matrix<T__, N__, M__>& operator*=(const T__ scalar)
+        Matrix<T__, N__, M__, S__>& operator*=(const T__ scalar)
         {
 #ifdef __NO_USE_SIMD__
             return (*this = (*this * scalar));
 #else
-            scalar_mul<T__, Matrix<T__, N__, M__>::size()>::mul(
+            scalar_mul<T__, N__ * M__>::mul(
                 buffer_, scalar, buffer_, size());
             return *this;
 #endif
         }
 
         //! Overload
-        Matrix<T__, N__, M__>& operator/=(const T__ scalar)
+        Matrix<T__, N__, M__, S__>& operator/=(const T__ scalar)
         {
 #ifdef __NO_USE_SIMD__
             return (*this = (*this / scalar));
@@ -357,81 +457,157 @@ namespace calc {
         }
 
         //! Overload
-        Matrix<T__, N__, M__> operator+(const Matrix<T__, N__, M__>& rhs) const
+        constexpr Matrix<T__, N__, M__, S__> operator+(
+            const Matrix<T__, N__, M__, S__>& rhs) const
         {
-#ifdef __NO_USE_SIMD__
-            Matrix<T__, N__, M__> out;
-            for (unsigned r = 0; r != N__; ++r) {
-                for (unsigned c = 0; c != M__; ++c) {
-                    out(r, c) = (*this)(r, c) + rhs(r, c);
-                }
+            Matrix<T__, N__, M__, S__> out(no_init);
+#ifndef __NO_USE_SIMD__
+            if (!std::is_constant_evaluated()) {
+                matrix_add<T__, N__ * M__>::add(
+                    buffer_, rhs.buffer_, out.buffer_, size());
+                return out;
             }
-#else
-            Matrix<T__, N__, M__> out;
-            matrix_add<T__, sizeof(T__)>::add(
-                buffer_, rhs.buffer_, out.buffer_, size());
 #endif
+            for (unsigned i = 0; i != size(); ++i)
+                out.buffer_[i] = buffer_[i] + rhs.buffer_[i];
             return out;
         }
 
         //! Overload
-        Matrix<T__, N__, M__>& operator+=(const Matrix<T__, N__, M__>& rhs)
+        Matrix<T__, N__, M__, S__>& operator+=(
+            const Matrix<T__, N__, M__, S__>& rhs)
         {
 #ifdef __NO_USE_SIMD__
             return (*this = (*this + rhs));
 #else
-            matrix_add<T__, sizeof(T__)>::add(
+            matrix_add<T__, N__ * M__>::add(
                 buffer_, rhs.buffer_, buffer_, size());
             return *this;
 #endif
         }
 
         //! Overload
-        Matrix<T__, N__, M__> operator-(const Matrix<T__, N__, M__>& rhs) const
+        constexpr Matrix<T__, N__, M__, S__> operator-(
+            const Matrix<T__, N__, M__, S__>& rhs) const
         {
-#ifdef __NO_USE_SIMD__
-            Matrix<T__, N__, M__> out;
-            for (unsigned r = 0; r != N__; ++r) {
-                for (unsigned c = 0; c != M__; ++c) {
-                    out(r, c) = (*this)(r, c) - rhs(r, c);
-                }
+            Matrix<T__, N__, M__, S__> out(no_init);
+#ifndef __NO_USE_SIMD__
+            if (!std::is_constant_evaluated()) {
+                matrix_sub<T__, N__ * M__>::sub(
+                    buffer_, rhs.buffer_, out.buffer_, size());
+                return out;
             }
-#else
-            Matrix<T__, N__, M__> out;
-            matrix_sub<T__, sizeof(T__)>::sub(
-                buffer_, rhs.buffer_, out.buffer_, size());
 #endif
+            for (unsigned i = 0; i != size(); ++i)
+                out.buffer_[i] = buffer_[i] - rhs.buffer_[i];
             return out;
         }
 
         //! Overload
-        Matrix<T__, N__, M__>& operator-=(const Matrix<T__, N__, M__>& rhs)
+        Matrix<T__, N__, M__, S__>& operator-=(
+            const Matrix<T__, N__, M__, S__>& rhs)
         {
 #ifdef __NO_USE_SIMD__
-            return (*this = (*this + rhs));
+            return (*this = (*this - rhs));
 #else
-            matrix_sub<T__, sizeof(T__)>::sub(
+            matrix_sub<T__, N__ * M__>::sub(
                 buffer_, rhs.buffer_, buffer_, size());
             return *this;
 #endif
         }
+    private:
+        // Helper
+        // Buffer offset of element (r, c)
+        static constexpr unsigned index(const unsigned r, const unsigned c)
+        {
+            if constexpr (S__ == storage::row_major)
+                return r * M__ + c;
+            else
+                return c * N__ + r;
+        }
+
+        // Helper
+        // Zeroes the alignment padding past the last element
+        constexpr void clear_padding()
+        {
+            std::fill(buffer_ + N__ * M__,
+                      buffer_ + sizeof(buffer_) / sizeof(T__),
+                      T__(0));
+        }
     };
 
     //! Overload
-    template <typename T__, unsigned N__ = 0, unsigned M__ = 0>
-    Matrix<T__, N__, M__> operator-(const Matrix<T__, N__, M__>& m)
+    template <typename T__, unsigned N__, unsigned M__, storage S__>
+    constexpr Matrix<T__, N__, M__, S__> operator-(
+        const Matrix<T__, N__, M__, S__>& m)
     {
         return m * -1;
     }
 
     //! Overload
-    template <typename T__, unsigned N__ = 0, unsigned M__ = 0>
-    Matrix<T__, N__, M__> operator*(const T__ scalar,
-                                    const Matrix<T__, N__, M__>& m)
+    template <typename T__, unsigned N__, unsigned M__, storage S__>
+    constexpr Matrix<T__, N__, M__, S__> operator*(
+        const T__ scalar, const Matrix<T__, N__, M__, S__>& m)
     {
         return m * scalar;
     }
 
+    //! @return
+    //!     Product of all factors, left to right; factors after the first
+    //!     may be scalars
+    /*! Chains of 4x4 float matrices are multiplied in a single pass that
+     *! keeps the running product in registers, with the scalars folded into
+     *! one scale applied as it is stored; other shapes fall back to
+     *! operator*. Sums are not fused and go through operator+ as before
+     */
+    template <typename T__,
+              unsigned N__,
+              unsigned M__,
+              storage S__,
+              typename... Rest>
+    constexpr auto compose(const Matrix<T__, N__, M__, S__>& first,
+                           const Rest&... rest)
+    {
+        if constexpr (sizeof...(Rest) == 0) {
+            return first;
+        }
+#ifndef __NO_USE_SIMD__
+        else if constexpr (std::is_same_v<Matrix<T__, N__, M__, S__>,
+                                          Matrix<float, 4, 4, S__>>
+                           && ((std::is_same_v<Rest, Matrix<float, 4, 4, S__>>
+                                || std::is_same_v<Rest, float>)
+                               && ...)) {
+            if (std::is_constant_evaluated())
+                return (first * ... * rest);
+
+            const float* factors[1 + sizeof...(Rest)] = {first};
+            unsigned count = 1;
+            float scale = 1;
+            (
+                [&](const auto& x) {
+                    using X = std::decay_t<decltype(x)>;
+                    if constexpr (std::is_same_v<X, float>)
+                        scale *= x;
+                    else
+                        factors[count++] = x;
+                }(rest),
+                ...);
+
+            // Column-major buffers are row-major transposes; multiply them
+            // in reverse order
+            if constexpr (S__ == storage::column_major)
+                std::reverse(factors, factors + count);
+
+            Matrix<float, 4, 4, S__> out(no_init);
+            matrix_chain<float, 4>::mul(factors, count, scale, out);
+            return out;
+        }
+#endif
+        else {
+            return (first * ... * rest);
+        }
+    }
+
     // 2x2
     using mat2f = Matrix<float, 2, 2>;
     // 3x3
@@ -439,6 +615,11 @@ namespace calc {
     // 4x4
     using mat4f = Matrix<float, 4, 4>;
 
+    // 3x3, column-major
+    using mat3f_cm = Matrix<float, 3, 3, storage::column_major>;
+    // 4x4, column-major
+    using mat4f_cm = Matrix<float, 4, 4, storage::column_major>;
+
     // 2x1
     using vec2f = Matrix<float, 2, 1>;
     // 3x1
@@ -2,20 +2,25 @@
 
 #include "matrix_nxm.hpp"
 
+#ifndef __NO_USE_SIMD__
+#include "simd/matrix_inverse.hpp"
+#include "simd/schur_mul.hpp"
+#endif
+
 namespace calc {
 
     //! @return
     //!     Pointer to matrix raw data
-    template <typename T, unsigned N, unsigned M>
-    inline T* data(Matrix<T, N, M>& m)
+    template <typename T, unsigned N, unsigned M, storage S>
+    constexpr T* data(Matrix<T, N, M, S>& m)
     {
         return static_cast<T*>(m);
     }
 
     //! @return
     //!     Pointer to matrix data
-    template <typename T, unsigned N, unsigned M>
-    inline const T* data(const Matrix<T, N, M>& m)
+    template <typename T, unsigned N, unsigned M, storage S>
+    constexpr const T* data(const Matrix<T, N, M, S>& m)
     {
         return static_cast<const T*>(m);
     }
@@ -23,8 +28,8 @@ namespace calc {
     //! @return
     //!     Cross product
     template <typename T>
-    inline Matrix<T, 4, 1> cross(const Matrix<T, 4, 1>& lhs,
-                                 const Matrix<T, 4, 1>& rhs)
+    constexpr Matrix<T, 4, 1> cross(const Matrix<T, 4, 1>& lhs,
+                                    const Matrix<T, 4, 1>& rhs)
     {
         Matrix<T, 4, 1> out;
 
@@ -38,8 +43,8 @@ namespace calc {
     //! @return
     //!     Cross product
     template <typename T>
-    inline Matrix<T, 3, 1> cross(const Matrix<T, 3, 1>& lhs,
-                                 const Matrix<T, 3, 1>& rhs)
+    constexpr Matrix<T, 3, 1> cross(const Matrix<T, 3, 1>& lhs,
+                                    const Matrix<T, 3, 1>& rhs)
     {
         Matrix<T, 3, 1> out;
 
@@ -53,8 +58,8 @@ namespace calc {
     //! @return
     //!     Cross product
     template <typename T>
-    inline Matrix<T, 3, 1> cross(const Matrix<T, 1, 3>& lhs,
-                                 const Matrix<T, 1, 3>& rhs)
+    constexpr Matrix<T, 3, 1> cross(const Matrix<T, 1, 3>& lhs,
+                                    const Matrix<T, 1, 3>& rhs)
     {
         Matrix<T, 3, 1> out;
 
@@ -79,28 +84,173 @@ namespace calc {
     }
 
     //! @return
-    //!     Transposed matrix
-    template <typename T, unsigned N, unsigned M>
-    inline Matrix<T, M, N> transpose(const Matrix<T, N, M>& in)
+    //!     Element-wise (Schur/Hadamard) product
+    template <typename T, unsigned N, unsigned M, storage S>
+    constexpr Matrix<T, N, M, S> schur(const Matrix<T, N, M, S>& lhs,
+                                       const Matrix<T, N, M, S>& rhs)
     {
-        Matrix<T, M, N> out;
+        Matrix<T, N, M, S> out(no_init);
+#ifndef __NO_USE_SIMD__
+        if (!std::is_constant_evaluated()) {
+            detail::schur_mul<T>::mul(lhs, rhs, out, lhs.size());
+            return out;
+        }
+#endif
+        for (unsigned i = 0; i != N * M; ++i)
+            data(out)[i] = data(lhs)[i] * data(rhs)[i];
+
+        return out;
+    }
 
-        std::size_t i = 0;
-        for (; i != in.size(); ++i) {
-            std::size_t r = i / N;
-            std::size_t c = i % N;
-            out(c, r) = in(r, c);
+    //! @return
+    //!     Transposed matrix, in the same storage order. To change storage
+    //!     order instead, convert: mat4f_cm(m) holds the same buffer as
+    //!     transpose(m)
+    template <typename T, unsigned N, unsigned M, storage S>
+    constexpr Matrix<T, M, N, S> transpose(const Matrix<T, N, M, S>& in)
+    {
+        Matrix<T, M, N, S> out(no_init);
+#ifndef __NO_USE_SIMD__
+        if constexpr (std::is_same_v<T, float> && N == M
+                      && (N == 3 || N == 4)) {
+            if (!std::is_constant_evaluated()) {
+                matrix_transpose<float, N>::transpose(in, out);
+                return out;
+            }
         }
+#endif
+        for (unsigned r = 0; r != N; ++r)
+            for (unsigned c = 0; c != M; ++c)
+                out(c, r) = in(r, c);
 
         return out;
     }
 
+    namespace detail {
+
+        // Helper
+        // General 4x4 inverse from 2x2 sub-determinants
+        constexpr void inverse_scalar(const float* m, float* out)
+        {
+            // Written in full before `out` is touched; in == out is fine
+            float inv[16] = {};
+
+            const float s0 = m[0] * m[5] - m[4] * m[1];
+            const float s1 = m[0] * m[6] - m[4] * m[2];
+            const float s2 = m[0] * m[7] - m[4] * m[3];
+            const float s3 = m[1] * m[6] - m[5] * m[2];
+            const float s4 = m[1] * m[7] - m[5] * m[3];
+            const float s5 = m[2] * m[7] - m[6] * m[3];
+
+            const float c5 = m[10] * m[15] - m[14] * m[11];
+            const float c4 = m[9] * m[15] - m[13] * m[11];
+            const float c3 = m[9] * m[14] - m[13] * m[10];
+            const float c2 = m[8] * m[15] - m[12] * m[11];
+            const float c1 = m[8] * m[14] - m[12] * m[10];
+            const float c0 = m[8] * m[13] - m[12] * m[9];
+
+            const float rdet = 1.0F
+                               / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2
+                                  - s4 * c1 + s5 * c0);
+
+            inv[0] = (m[5] * c5 - m[6] * c4 + m[7] * c3) * rdet;
+            inv[1] = (-m[1] * c5 + m[2] * c4 - m[3] * c3) * rdet;
+            inv[2] = (m[13] * s5 - m[14] * s4 + m[15] * s3) * rdet;
+            inv[3] = (-m[9] * s5 + m[10] * s4 - m[11] * s3) * rdet;
+
+            inv[4] = (-m[4] * c5 + m[6] * c2 - m[7] * c1) * rdet;
+            inv[5] = (m[0] * c5 - m[2] * c2 + m[3] * c1) * rdet;
+            inv[6] = (-m[12] * s5 + m[14] * s2 - m[15] * s1) * rdet;
+            inv[7] = (m[8] * s5 - m[10] * s2 + m[11] * s1) * rdet;
+
+            inv[8] = (m[4] * c4 - m[5] * c2 + m[7] * c0) * rdet;
+            inv[9] = (-m[0] * c4 + m[1] * c2 - m[3] * c0) * rdet;
+            inv[10] = (m[12] * s4 - m[13] * s2 + m[15] * s0) * rdet;
+            inv[11] = (-m[8] * s4 + m[9] * s2 - m[11] * s0) * rdet;
+
+            inv[12] = (-m[4] * c3 + m[5] * c1 - m[6] * c0) * rdet;
+            inv[13] = (m[0] * c3 - m[1] * c1 + m[2] * c0) * rdet;
+            inv[14] = (-m[12] * s3 + m[13] * s1 - m[14] * s0) * rdet;
+            inv[15] = (m[8] * s3 - m[9] * s1 + m[10] * s0) * rdet;
+
+            std::copy_n(inv, 16, out);
+        }
+
+        // Helper
+        // Inverse of | R t ; 0 1 | with orthogonal columns in R
+        constexpr void inverse_affine_scalar(const float* m, float* out)
+        {
+            float inv[16] = {};
+
+            for (unsigned c = 0; c != 3; ++c) {
+                const float len = m[c] * m[c] + m[4 + c] * m[4 + c]
+                                  + m[8 + c] * m[8 + c];
+                for (unsigned r = 0; r != 3; ++r)
+                    inv[c * 4 + r] = m[r * 4 + c] / len;
+            }
+
+            for (unsigned r = 0; r != 3; ++r)
+                inv[r * 4 + 3] = -(inv[r * 4] * m[3] + inv[r * 4 + 1] * m[7]
+                                   + inv[r * 4 + 2] * m[11]);
+
+            inv[12] = 0;
+            inv[13] = 0;
+            inv[14] = 0;
+            inv[15] = 1;
+
+            std::copy_n(inv, 16, out);
+        }
+    } // namespace detail
+
+    //! @return
+    //!     Inverse matrix; singular input yields inf/nan. The kernel serves
+    //!     either storage order since inverse(A') = inverse(A)'
+    template <storage S = storage::row_major>
+    constexpr Matrix<float, 4, 4, S> inverse(const Matrix<float, 4, 4, S>& m)
+    {
+        Matrix<float, 4, 4, S> out(no_init);
+#ifndef __NO_USE_SIMD__
+        if (!std::is_constant_evaluated()) {
+            matrix_inverse<float, 4>::inverse(m, out);
+            return out;
+        }
+#endif
+        detail::inverse_scalar(m, out);
+        return out;
+    }
+
+    //! @return
+    //!     Inverse of a rotation/scale/translation matrix (bottom row
+    //!     0 0 0 1, mutually orthogonal upper-left columns); cheaper than
+    //!     inverse() and exact for model matrices
+    constexpr Matrix<float, 4, 4> inverse_affine(const Matrix<float, 4, 4>& m)
+    {
+        Matrix<float, 4, 4> out(no_init);
+#ifndef __NO_USE_SIMD__
+        if (!std::is_constant_evaluated()) {
+            matrix_inverse<float, 4>::affine(m, out);
+            return out;
+        }
+#endif
+        detail::inverse_affine_scalar(m, out);
+        return out;
+    }
+
+    //! @return
+    //!     Affine inverse of a column-major matrix
+    constexpr Matrix<float, 4, 4, storage::column_major> inverse_affine(
+        const Matrix<float, 4, 4, storage::column_major>& m)
+    {
+        return Matrix<float, 4, 4, storage::column_major>(
+            inverse_affine(Matrix<float, 4, 4>(m)));
+    }
+
     //! @return
     //!     Absolute-valued matrix
-    template <typename T, unsigned N, unsigned M>
-    inline Matrix<T, N, M> abs(const Matrix<T, N, M>& inp)
+    template <typename T, unsigned N, unsigned M, storage S>
+    inline Matrix<T, N, M, S> abs(const Matrix<T, N, M, S>& inp)
     {
-        Matrix<T, N, M> out;
+        Matrix<T, N, M, S> out;
         for (unsigned r = 0; r != N; ++r) {
             for (unsigned c = 0; c != M; ++c) {
                 out(r, c) = std::abs(inp(r, c));
@@ -111,8 +261,8 @@ namespace calc {
     }
 
     template <unsigned N>
-    inline Matrix<float, N, 1> max(const Matrix<float, N, 1>& lhs,
-                                   const Matrix<float, N, 1>& rhs)
+    constexpr Matrix<float, N, 1> max(const Matrix<float, N, 1>& lhs,
+                                      const Matrix<float, N, 1>& rhs)
     {
         Matrix<float, N, 1> out;
 
@@ -123,8 +273,8 @@ namespace calc {
     }
 
     template <unsigned N>
-    inline Matrix<float, N, 1> min(const Matrix<float, N, 1>& lhs,
-                                   const Matrix<float, N, 1>& rhs)
+    constexpr Matrix<float, N, 1> min(const Matrix<float, N, 1>& lhs,
+                                      const Matrix<float, N, 1>& rhs)
     {
         Matrix<float, N, 1> out;
 
@@ -137,8 +287,8 @@ namespace calc {
     //! @return
     //!     Dot product: lhs * rhs
     template <unsigned N>
-    inline float dot(const Matrix<float, N, 1>& lhs,
-                     const Matrix<float, N, 1>& rhs)
+    constexpr float dot(const Matrix<float, N, 1>& lhs,
+                        const Matrix<float, N, 1>& rhs)
     {
         float sum = 0;
 
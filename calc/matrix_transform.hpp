@@ -2,24 +2,168 @@
 
 #include "matrix_nxm.hpp"
 
+#ifndef __NO_USE_SIMD__
+#include "simd/sincos.hpp"
+#else
+namespace calc {
+
+    //! Polynomial degree used by the vectorized sine/cosine; unused by the
+    //! scalar build
+    enum class sincos_accuracy { fast, precise };
+}
+#endif
+
 namespace calc {
 
     //! 3.1415926...
-    const float kPi = std::atan(1.0) * 4;
+    inline constexpr float kPi = 3.14159265358979323846F;
 
     //! @return angle in radians
-    inline float radians(const float deg)
+    constexpr float radians(const float deg)
     {
         return kPi * deg / 180.0;
     }
 
+    namespace detail {
+
+        // Helper
+        // Reduces the angle to [-pi, pi]
+        constexpr double reduce_angle(double rad)
+        {
+            constexpr double kTwoPi = 6.28318530717958647692;
+
+            const long long turns = static_cast<long long>(rad / kTwoPi);
+            rad -= static_cast<double>(turns) * kTwoPi;
+            if (rad > kTwoPi / 2)
+                rad -= kTwoPi;
+            else if (rad < -kTwoPi / 2)
+                rad += kTwoPi;
+            return rad;
+        }
+
+        // Helper
+        // Taylor series sine, exact to float precision over [-pi, pi]
+        constexpr float constexpr_sin(const float rad)
+        {
+            const double x = reduce_angle(rad);
+            const double x2 = x * x;
+
+            double term = x;
+            double sum = x;
+            for (int i = 1; i != 12; ++i) {
+                term *= -x2 / ((2 * i) * (2 * i + 1));
+                sum += term;
+            }
+
+            return static_cast<float>(sum);
+        }
+
+        // Helper
+        // Taylor series cosine, exact to float precision over [-pi, pi]
+        constexpr float constexpr_cos(const float rad)
+        {
+            const double x = reduce_angle(rad);
+            const double x2 = x * x;
+
+            double term = 1;
+            double sum = 1;
+            for (int i = 1; i != 12; ++i) {
+                term *= -x2 / ((2 * i - 1) * (2 * i));
+                sum += term;
+            }
+
+            return static_cast<float>(sum);
+        }
+
+        // Helper
+        // std::sin at run time, the series during constant evaluation
+        constexpr float sin(const float rad)
+        {
+            if (std::is_constant_evaluated())
+                return constexpr_sin(rad);
+            return std::sin(rad);
+        }
+
+        // Helper
+        // std::cos at run time, the series during constant evaluation
+        constexpr float cos(const float rad)
+        {
+            if (std::is_constant_evaluated())
+                return constexpr_cos(rad);
+            return std::cos(rad);
+        }
+
+        // Helper
+        // Sine and cosine of three angles; one SIMD pass at run time
+        constexpr void sincos3(const float (&rad)[3],
+                               float (&s)[3],
+                               float (&c)[3])
+        {
+#ifndef __NO_USE_SIMD__
+            if (!std::is_constant_evaluated()) {
+                __m128 vs;
+                __m128 vc;
+                simd_sincos<>::sincos(
+                    _mm_setr_ps(rad[0], rad[1], rad[2], 0), vs, vc);
+
+                float bs[4] __attribute__((aligned(16)));
+                float bc[4] __attribute__((aligned(16)));
+                _mm_store_ps(bs, vs);
+                _mm_store_ps(bc, vc);
+                for (unsigned i = 0; i != 3; ++i) {
+                    s[i] = bs[i];
+                    c[i] = bc[i];
+                }
+                return;
+            }
+#endif
+            for (unsigned i = 0; i != 3; ++i) {
+                s[i] = sin(rad[i]);
+                c[i] = cos(rad[i]);
+            }
+        }
+
+        // Helper
+        // (r, c) accessor over raw row-major storage
+        template <unsigned M>
+        struct row_major_view {
+            float* data;
+
+            constexpr float& operator()(unsigned r, unsigned c)
+            {
+                return data[r * M + c];
+            }
+        };
+
+        // Helper
+        // Writes the rows of Rx(a) * Ry(b) * Rz(c) given the sines and
+        // cosines of the three angles
+        template <typename Matrix_>
+        constexpr void euler_rows(const float (&s)[3],
+                                  const float (&c)[3],
+                                  Matrix_& out)
+        {
+            out(0, 0) = c[1] * c[2];
+            out(0, 1) = -c[1] * s[2];
+            out(0, 2) = s[1];
+
+            out(1, 0) = s[0] * s[1] * c[2] + c[0] * s[2];
+            out(1, 1) = c[0] * c[2] - s[0] * s[1] * s[2];
+            out(1, 2) = -s[0] * c[1];
+
+            out(2, 0) = s[0] * s[2] - c[0] * s[1] * c[2];
+            out(2, 1) = c[0] * s[1] * s[2] + s[0] * c[2];
+            out(2, 2) = c[0] * c[1];
+        }
+    } // namespace detail
+
     //! @return rotation matrix
-    inline mat4f rotate_4x(const float rad)
+    constexpr mat4f rotate_4x(const float rad)
     {
         const float r[] = {
             1, 0, 0, 0,
-            0, std::cos(rad), (-std::sin(rad)), 0,
-            0, std::sin(rad), (+std::cos(rad)), 0,
+            0, detail::cos(rad), (-detail::sin(rad)), 0,
+            0, detail::sin(rad), (+detail::cos(rad)), 0,
             0, 0, 0, 1,
         };
 
@@ -27,24 +171,24 @@ namespace calc {
     }
 
     //! @return rotation matrix
-    inline mat3f rotate_3x(const float rad)
+    constexpr mat3f rotate_3x(const float rad)
     {
         const float r[] = {
             1, 0, 0,
-            0, std::cos(rad), (-std::sin(rad)),
-            0, std::sin(rad), (+std::cos(rad)),
+            0, detail::cos(rad), (-detail::sin(rad)),
+            0, detail::sin(rad), (+detail::cos(rad)),
         };
 
         return mat3f(r);
     }
 
     //! @return rotation matrix
-    inline mat4f rotate_4y(const float rad)
+    constexpr mat4f rotate_4y(const float rad)
     {
         const float r[] = {
-            (+std::cos(rad)), 0, std::sin(rad), 0,
+            (+detail::cos(rad)), 0, detail::sin(rad), 0,
             0, 1, 0, 0,
-            (-std::sin(rad)), 0, std::cos(rad), 0,
+            (-detail::sin(rad)), 0, detail::cos(rad), 0,
             0, 0, 0, 1,
         };
 
@@ -52,24 +196,23 @@ namespace calc {
     }
 
     //! @return rotation matrix
-    inline mat3f rotate_3y(float rad)
+    constexpr mat3f rotate_3y(float rad)
     {
         const float r[] = {
-            (+std::cos(rad)), 0, std::sin(rad),
+            (+detail::cos(rad)), 0, detail::sin(rad),
             0, 1, 0,
-            (-std::sin(rad)), 0, std::cos(rad),
-            0, 0, 1,
+            (-detail::sin(rad)), 0, detail::cos(rad),
         };
 
         return mat3f(r);
     }
 
     //! @return rotation matrix
-    inline mat4f rotate_4z(const float rad)
+    constexpr mat4f rotate_4z(const float rad)
     {
         const float r[] = {
-            std::cos(rad), (-std::sin(rad)), 0, 0,
-            std::sin(rad), (+std::cos(rad)), 0, 0,
+            detail::cos(rad), (-detail::sin(rad)), 0, 0,
+            detail::sin(rad), (+detail::cos(rad)), 0, 0,
             0, 0, 1, 0,
             0, 0, 0, 1,
         };
@@ -78,14 +221,45 @@ namespace calc {
     }
 
     //! @return rotation matrix
-    static inline mat3f rotate_3z(const float rad)
+    constexpr mat3f rotate_3z(const float rad)
     {
         const float r[] = {
-            std::cos(rad), (-std::sin(rad)), 0,
-            std::sin(rad), (+std::cos(rad)), 0,
+            detail::cos(rad), (-detail::sin(rad)), 0,
+            detail::sin(rad), (+detail::cos(rad)), 0,
             0, 0, 1,
         };
 
         return mat3f(r);
     }
+
+    //! @return rotation matrix
+    //!     rotate_4x(pitch) * rotate_4y(yaw) * rotate_4z(roll), built in one
+    //!     pass from a single vectorized sincos
+    constexpr mat4f rotate_euler_4(const float pitch,
+                                   const float yaw,
+                                   const float roll)
+    {
+        float s[3] = {};
+        float c[3] = {};
+        detail::sincos3({pitch, yaw, roll}, s, c);
+
+        mat4f out = mat4f::identity();
+        detail::euler_rows(s, c, out);
+        return out;
+    }
+
+    //! @return rotation matrix
+    //!     rotate_3x(pitch) * rotate_3y(yaw) * rotate_3z(roll)
+    constexpr mat3f rotate_euler_3(const float pitch,
+                                   const float yaw,
+                                   const float roll)
+    {
+        float s[3] = {};
+        float c[3] = {};
+        detail::sincos3({pitch, yaw, roll}, s, c);
+
+        mat3f out(no_init);
+        detail::euler_rows(s, c, out);
+        return out;
+    }
 } // namespace calc
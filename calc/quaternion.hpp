@@ -0,0 +1,237 @@
+#pragma once
+
+#include "matrix_nxm.hpp"
+#include "matrix_operation.hpp"
+#include <cmath>
+
+#ifndef __NO_USE_SIMD__
+#include "simd/quat.hpp"
+#endif
+
+namespace calc {
+
+    //! class Quaternion
+    /*! Defines a rotation quaternion, stored (x, y, z, w) with the vector
+     *! part first
+     */
+    template <typename T__>
+    class Quaternion {
+        // Quaternion components
+        T__ buffer_[4] __attribute__((aligned(16)));
+    public:
+        //! @return the no-rotation quaternion
+        static constexpr Quaternion<T__> identity()
+        {
+            return Quaternion<T__>(0, 0, 0, 1);
+        }
+
+        //! @return rotation by `rad` around the unit vector `axis`
+        static Quaternion<T__> from_axis_angle(const Matrix<T__, 3, 1>& axis,
+                                               const T__ rad)
+        {
+            const T__ s = std::sin(rad / 2);
+            return Quaternion<T__>(
+                axis[0] * s, axis[1] * s, axis[2] * s, std::cos(rad / 2));
+        }
+
+        constexpr operator T__*()
+        {
+            return buffer_;
+        }
+
+        constexpr operator const T__*() const
+        {
+            return buffer_;
+        }
+
+        //! Ctor.
+        constexpr Quaternion()
+            : buffer_{0, 0, 0, 1}
+        {}
+
+        //! Ctor.
+        constexpr Quaternion(T__ x, T__ y, T__ z, T__ w)
+            : buffer_{x, y, z, w}
+        {}
+
+        //! Overload
+        constexpr T__& operator[](unsigned i)
+        {
+            return buffer_[i];
+        }
+
+        //! Overload
+        constexpr const T__& operator[](unsigned i) const
+        {
+            return buffer_[i];
+        }
+
+        //! Overload
+        //! Hamilton product; applies `rhs` first, then *this
+        Quaternion<T__> operator*(const Quaternion<T__>& rhs) const
+        {
+            Quaternion<T__> out;
+#ifndef __NO_USE_SIMD__
+            if constexpr (std::is_same_v<T__, float>) {
+                quat_mul::mul(buffer_, rhs.buffer_, out.buffer_);
+                return out;
+            }
+#endif
+            const T__* p = buffer_;
+            const T__* q = rhs.buffer_;
+            out[0] = p[3] * q[0] + p[0] * q[3] + p[1] * q[2] - p[2] * q[1];
+            out[1] = p[3] * q[1] - p[0] * q[2] + p[1] * q[3] + p[2] * q[0];
+            out[2] = p[3] * q[2] + p[0] * q[1] - p[1] * q[0] + p[2] * q[3];
+            out[3] = p[3] * q[3] - p[0] * q[0] - p[1] * q[1] - p[2] * q[2];
+            return out;
+        }
+
+        //! Overload
+        Quaternion<T__>& operator*=(const Quaternion<T__>& rhs)
+        {
+            return (*this = (*this * rhs));
+        }
+    };
+
+    //! @return
+    //!     Dot product
+    template <typename T>
+    constexpr T dot(const Quaternion<T>& lhs, const Quaternion<T>& rhs)
+    {
+        return lhs[0] * rhs[0] + lhs[1] * rhs[1] + lhs[2] * rhs[2]
+               + lhs[3] * rhs[3];
+    }
+
+    //! @return
+    //!     Conjugate; the inverse of a unit quaternion
+    template <typename T>
+    constexpr Quaternion<T> conjugate(const Quaternion<T>& q)
+    {
+        return Quaternion<T>(-q[0], -q[1], -q[2], q[3]);
+    }
+
+    //! @return
+    //!     Unit quaternion
+    template <typename T>
+    inline Quaternion<T> normal(const Quaternion<T>& q)
+    {
+        Quaternion<T> out;
+#ifndef __NO_USE_SIMD__
+        if constexpr (std::is_same_v<T, float>) {
+            quat_normal::normal(q, out);
+            return out;
+        }
+#endif
+        const T mag = std::sqrt(dot(q, q));
+        for (unsigned i = 0; i != 4; ++i)
+            out[i] = q[i] / mag;
+        return out;
+    }
+
+    //! @return
+    //!     Normalized linear interpolation from `a` (t = 0) to `b` (t = 1)
+    //!     along the shorter arc
+    template <typename T>
+    inline Quaternion<T> nlerp(const Quaternion<T>& a,
+                               const Quaternion<T>& b,
+                               const T t)
+    {
+        Quaternion<T> out;
+#ifndef __NO_USE_SIMD__
+        if constexpr (std::is_same_v<T, float>) {
+            quat_nlerp::nlerp(a, b, t, out);
+            return out;
+        }
+#endif
+        const T sign = dot(a, b) < 0 ? -1 : 1;
+        for (unsigned i = 0; i != 4; ++i)
+            out[i] = a[i] + (sign * b[i] - a[i]) * t;
+        return normal(out);
+    }
+
+    //! @return
+    //!     Spherical linear interpolation from `a` (t = 0) to `b` (t = 1)
+    //!     along the shorter arc
+    template <typename T>
+    inline Quaternion<T> slerp(const Quaternion<T>& a,
+                               const Quaternion<T>& b,
+                               const T t)
+    {
+        Quaternion<T> out;
+#ifndef __NO_USE_SIMD__
+        if constexpr (std::is_same_v<T, float>) {
+            quat_slerp::slerp(a, b, t, out);
+            return out;
+        }
+#endif
+        T d = dot(a, b);
+        const T sign = d < 0 ? -1 : 1;
+        d *= sign;
+
+        // Nearly parallel; the weights below lose precision
+        if (d > T(0.9995))
+            return nlerp(a, b, t);
+
+        const T theta = std::acos(d);
+        const T wa = std::sin((1 - t) * theta) / std::sin(theta);
+        const T wb = sign * std::sin(t * theta) / std::sin(theta);
+        for (unsigned i = 0; i != 4; ++i)
+            out[i] = a[i] * wa + b[i] * wb;
+        return out;
+    }
+
+    //! @return
+    //!     `q` advanced by angular velocity `omega` (radians per unit time,
+    //!     world axes) over `dt`; first-order step followed by
+    //!     renormalization, which keeps the orientation free of drift
+    template <typename T>
+    inline Quaternion<T> integrate(const Quaternion<T>& q,
+                                   const Matrix<T, 3, 1>& omega,
+                                   const T dt)
+    {
+        const T h = dt / 2;
+        const Quaternion<T> spin
+            = Quaternion<T>(omega[0] * h, omega[1] * h, omega[2] * h, 0) * q;
+
+        Quaternion<T> out;
+        for (unsigned i = 0; i != 4; ++i)
+            out[i] = q[i] + spin[i];
+        return normal(out);
+    }
+
+    //! @return
+    //!     Rotation matrix of the unit quaternion `q`, in storage order S
+    template <storage S = storage::row_major, typename T>
+    constexpr Matrix<T, 4, 4, S> rotate_4(const Quaternion<T>& q)
+    {
+        const T x = q[0];
+        const T y = q[1];
+        const T z = q[2];
+        const T w = q[3];
+
+        Matrix<T, 4, 4, S> out(no_init);
+        out(0, 0) = 1 - 2 * (y * y + z * z);
+        out(0, 1) = 2 * (x * y - w * z);
+        out(0, 2) = 2 * (x * z + w * y);
+        out(0, 3) = 0;
+
+        out(1, 0) = 2 * (x * y + w * z);
+        out(1, 1) = 1 - 2 * (x * x + z * z);
+        out(1, 2) = 2 * (y * z - w * x);
+        out(1, 3) = 0;
+
+        out(2, 0) = 2 * (x * z - w * y);
+        out(2, 1) = 2 * (y * z + w * x);
+        out(2, 2) = 1 - 2 * (x * x + y * y);
+        out(2, 3) = 0;
+
+        out(3, 0) = 0;
+        out(3, 1) = 0;
+        out(3, 2) = 0;
+        out(3, 3) = 1;
+        return out;
+    }
+
+    // Quaternion
+    using quatf = Quaternion<float>;
+} // namespace calc
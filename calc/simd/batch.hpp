@@ -0,0 +1,713 @@
+#pragma once
+
+#ifndef _CALC_SIMD_BATCH_HPP
+#define _CALC_SIMD_BATCH_HPP
+
+#include <cstddef>
+
+#include "common.hpp"
+#include "cpu.hpp"
+#include "matrix_transpose.hpp"
+#include "sincos.hpp"
+
+namespace calc {
+
+    namespace detail {
+
+        //! Helper
+        //! @return (lo, lo, lo, lo, hi, hi, hi, hi)
+        __attribute__((target("avx2,fma"))) inline __m256 set2x4(float lo,
+                                                                  float hi)
+        {
+            return _mm256_set_m128(_mm_set1_ps(hi), _mm_set1_ps(lo));
+        }
+
+        //! out[i] = lhs * in[i]; SSE
+        inline void batch_mul_lhs_sse(const float* lhs,
+                                      const float* in,
+                                      float* out,
+                                      std::size_t count)
+        {
+            for (std::size_t i = 0; i != count; ++i, in += 16, out += 16) {
+                const __m128 b0 = _mm_loadu_ps(in);
+                const __m128 b1 = _mm_loadu_ps(in + 4);
+                const __m128 b2 = _mm_loadu_ps(in + 8);
+                const __m128 b3 = _mm_loadu_ps(in + 12);
+
+                for (unsigned r = 0; r != 16; r += 4) {
+                    __m128 sum = _mm_mul_ps(_mm_set1_ps(lhs[r + 0]), b0);
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(lhs[r + 1]), b1));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(lhs[r + 2]), b2));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(lhs[r + 3]), b3));
+                    _mm_storeu_ps(out + r, sum);
+                }
+            }
+        }
+
+        //! out[i] = lhs * in[i]; AVX2/FMA, two output rows per register
+        __attribute__((target("avx2,fma"))) inline void batch_mul_lhs_fma(
+            const float* lhs,
+            const float* in,
+            float* out,
+            std::size_t count)
+        {
+            // LHS coefficients, rows 0|1 and 2|3 in the low|high lanes
+            const __m256 a00 = set2x4(lhs[0], lhs[4]);
+            const __m256 a01 = set2x4(lhs[1], lhs[5]);
+            const __m256 a02 = set2x4(lhs[2], lhs[6]);
+            const __m256 a03 = set2x4(lhs[3], lhs[7]);
+
+            const __m256 a20 = set2x4(lhs[8], lhs[12]);
+            const __m256 a21 = set2x4(lhs[9], lhs[13]);
+            const __m256 a22 = set2x4(lhs[10], lhs[14]);
+            const __m256 a23 = set2x4(lhs[11], lhs[15]);
+
+            for (std::size_t i = 0; i != count; ++i, in += 16, out += 16) {
+                const __m256 b0 = _mm256_broadcast_ps((const __m128*)(in));
+                const __m256 b1 = _mm256_broadcast_ps((const __m128*)(in + 4));
+                const __m256 b2 = _mm256_broadcast_ps((const __m128*)(in + 8));
+                const __m256 b3 = _mm256_broadcast_ps((const __m128*)(in + 12));
+
+                __m256 out01 = _mm256_mul_ps(a00, b0);
+                __m256 out23 = _mm256_mul_ps(a20, b0);
+                out01 = _mm256_fmadd_ps(a01, b1, out01);
+                out23 = _mm256_fmadd_ps(a21, b1, out23);
+                out01 = _mm256_fmadd_ps(a02, b2, out01);
+                out23 = _mm256_fmadd_ps(a22, b2, out23);
+                out01 = _mm256_fmadd_ps(a03, b3, out01);
+                out23 = _mm256_fmadd_ps(a23, b3, out23);
+
+                _mm256_storeu_ps(out, out01);
+                _mm256_storeu_ps(out + 8, out23);
+            }
+        }
+
+        //! out[i] = in[i] * rhs; SSE
+        inline void batch_mul_rhs_sse(const float* in,
+                                      const float* rhs,
+                                      float* out,
+                                      std::size_t count)
+        {
+            const __m128 c0 = _mm_loadu_ps(rhs);
+            const __m128 c1 = _mm_loadu_ps(rhs + 4);
+            const __m128 c2 = _mm_loadu_ps(rhs + 8);
+            const __m128 c3 = _mm_loadu_ps(rhs + 12);
+
+            for (std::size_t i = 0; i != count * 16; i += 4) {
+                const __m128 r = _mm_loadu_ps(in + i);
+
+                __m128 sum = _mm_mul_ps(_mm_shuffle_ps(r, r, 0x00), c0);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(r, r, 0x55), c1));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(r, r, 0xaa), c2));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(r, r, 0xff), c3));
+
+                _mm_storeu_ps(out + i, sum);
+            }
+        }
+
+        //! out[i] = in[i] * rhs; AVX2/FMA, two input rows per register
+        __attribute__((target("avx2,fma"))) inline void batch_mul_rhs_fma(
+            const float* in,
+            const float* rhs,
+            float* out,
+            std::size_t count)
+        {
+            const __m256 c0 = _mm256_broadcast_ps((const __m128*)(rhs));
+            const __m256 c1 = _mm256_broadcast_ps((const __m128*)(rhs + 4));
+            const __m256 c2 = _mm256_broadcast_ps((const __m128*)(rhs + 8));
+            const __m256 c3 = _mm256_broadcast_ps((const __m128*)(rhs + 12));
+
+            for (std::size_t i = 0; i != count * 16; i += 8) {
+                const __m256 r = _mm256_loadu_ps(in + i);
+
+                __m256 sum = _mm256_mul_ps(_mm256_shuffle_ps(r, r, 0x00), c0);
+                sum = _mm256_fmadd_ps(_mm256_shuffle_ps(r, r, 0x55), c1, sum);
+                sum = _mm256_fmadd_ps(_mm256_shuffle_ps(r, r, 0xaa), c2, sum);
+                sum = _mm256_fmadd_ps(_mm256_shuffle_ps(r, r, 0xff), c3, sum);
+
+                _mm256_storeu_ps(out + i, sum);
+            }
+        }
+
+        //! out[i] = m * in[i] over packed xyzw vectors; SSE
+        inline void batch_transform_aos_sse(const float* m,
+                                            const float* in,
+                                            float* out,
+                                            std::size_t count)
+        {
+            // Matrix columns
+            const __m128 c0 = _mm_setr_ps(m[0], m[4], m[8], m[12]);
+            const __m128 c1 = _mm_setr_ps(m[1], m[5], m[9], m[13]);
+            const __m128 c2 = _mm_setr_ps(m[2], m[6], m[10], m[14]);
+            const __m128 c3 = _mm_setr_ps(m[3], m[7], m[11], m[15]);
+
+            for (std::size_t i = 0; i != count * 4; i += 4) {
+                const __m128 v = _mm_loadu_ps(in + i);
+
+                __m128 sum = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), c0);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), c1));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xaa), c2));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xff), c3));
+
+                _mm_storeu_ps(out + i, sum);
+            }
+        }
+
+        //! out[i] = m * in[i] over packed xyzw vectors; AVX2/FMA, two
+        //! vectors per register
+        __attribute__((target("avx2,fma"))) inline void batch_transform_aos_fma(
+            const float* m,
+            const float* in,
+            float* out,
+            std::size_t count)
+        {
+            const __m128 c0 = _mm_setr_ps(m[0], m[4], m[8], m[12]);
+            const __m128 c1 = _mm_setr_ps(m[1], m[5], m[9], m[13]);
+            const __m128 c2 = _mm_setr_ps(m[2], m[6], m[10], m[14]);
+            const __m128 c3 = _mm_setr_ps(m[3], m[7], m[11], m[15]);
+
+            const __m256 cc0 = _mm256_set_m128(c0, c0);
+            const __m256 cc1 = _mm256_set_m128(c1, c1);
+            const __m256 cc2 = _mm256_set_m128(c2, c2);
+            const __m256 cc3 = _mm256_set_m128(c3, c3);
+
+            std::size_t i = 0;
+            for (; i + 8 <= count * 4; i += 8) {
+                const __m256 v = _mm256_loadu_ps(in + i);
+
+                __m256 sum = _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0x00), cc0);
+                sum = _mm256_fmadd_ps(_mm256_shuffle_ps(v, v, 0x55), cc1, sum);
+                sum = _mm256_fmadd_ps(_mm256_shuffle_ps(v, v, 0xaa), cc2, sum);
+                sum = _mm256_fmadd_ps(_mm256_shuffle_ps(v, v, 0xff), cc3, sum);
+
+                _mm256_storeu_ps(out + i, sum);
+            }
+
+            // Odd vector
+            if (i != count * 4) {
+                const __m128 v = _mm_loadu_ps(in + i);
+
+                __m128 sum = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), c0);
+                sum = _mm_fmadd_ps(_mm_shuffle_ps(v, v, 0x55), c1, sum);
+                sum = _mm_fmadd_ps(_mm_shuffle_ps(v, v, 0xaa), c2, sum);
+                sum = _mm_fmadd_ps(_mm_shuffle_ps(v, v, 0xff), c3, sum);
+
+                _mm_storeu_ps(out + i, sum);
+            }
+        }
+
+        //! Helper
+        //! out = m * in for a single structure-of-arrays lane
+        inline void batch_transform_soa_lane(const float* m,
+                                             const float* const in[4],
+                                             float* const out[4],
+                                             std::size_t i)
+        {
+            const float x = in[0][i];
+            const float y = in[1][i];
+            const float z = in[2][i];
+            const float w = in[3][i];
+
+            for (unsigned r = 0; r != 4; ++r) {
+                out[r][i] = m[r * 4 + 0] * x + m[r * 4 + 1] * y
+                            + m[r * 4 + 2] * z + m[r * 4 + 3] * w;
+            }
+        }
+
+        //! out = m * in over structure-of-arrays vectors; SSE, 4 lanes
+        inline void batch_transform_soa_sse(const float* m,
+                                            const float* const in[4],
+                                            float* const out[4],
+                                            std::size_t count)
+        {
+            const std::size_t body = count - count % 4;
+
+            std::size_t i = 0;
+            for (; i != body; i += 4) {
+                const __m128 x = _mm_loadu_ps(in[0] + i);
+                const __m128 y = _mm_loadu_ps(in[1] + i);
+                const __m128 z = _mm_loadu_ps(in[2] + i);
+                const __m128 w = _mm_loadu_ps(in[3] + i);
+
+                for (unsigned r = 0; r != 4; ++r) {
+                    __m128 sum = _mm_mul_ps(_mm_set1_ps(m[r * 4 + 0]), x);
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[r * 4 + 1]), y));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[r * 4 + 2]), z));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[r * 4 + 3]), w));
+                    _mm_storeu_ps(out[r] + i, sum);
+                }
+            }
+
+            for (; i < count; ++i)
+                batch_transform_soa_lane(m, in, out, i);
+        }
+
+        //! out = m * in over structure-of-arrays vectors; AVX2/FMA, 8 lanes
+        __attribute__((target("avx2,fma"))) inline void batch_transform_soa_fma(
+            const float* m,
+            const float* const in[4],
+            float* const out[4],
+            std::size_t count)
+        {
+            __m256 coef[16];
+            for (unsigned i = 0; i != 16; ++i)
+                coef[i] = _mm256_set1_ps(m[i]);
+
+            const std::size_t body = count - count % 8;
+
+            std::size_t i = 0;
+            for (; i != body; i += 8) {
+                const __m256 x = _mm256_loadu_ps(in[0] + i);
+                const __m256 y = _mm256_loadu_ps(in[1] + i);
+                const __m256 z = _mm256_loadu_ps(in[2] + i);
+                const __m256 w = _mm256_loadu_ps(in[3] + i);
+
+                for (unsigned r = 0; r != 4; ++r) {
+                    __m256 sum = _mm256_mul_ps(coef[r * 4 + 0], x);
+                    sum = _mm256_fmadd_ps(coef[r * 4 + 1], y, sum);
+                    sum = _mm256_fmadd_ps(coef[r * 4 + 2], z, sum);
+                    sum = _mm256_fmadd_ps(coef[r * 4 + 3], w, sum);
+                    _mm256_storeu_ps(out[r] + i, sum);
+                }
+            }
+
+            for (; i < count; ++i)
+                batch_transform_soa_lane(m, in, out, i);
+        }
+
+        //! Helper
+        //! Stores Rx(a) * Ry(b) * Rz(c) for 4 lanes of sines/cosines as 4
+        //! packed row-major matrices
+        inline void batch_euler_store(const __m128 (&s)[3],
+                                      const __m128 (&c)[3],
+                                      float* out)
+        {
+            const __m128 signMask = _mm_set1_ps(-0.0F);
+            const __m128 s0s1 = _mm_mul_ps(s[0], s[1]);
+            const __m128 c0s1 = _mm_mul_ps(c[0], s[1]);
+
+            __m128 r00 = _mm_mul_ps(c[1], c[2]);
+            __m128 r01 = _mm_xor_ps(_mm_mul_ps(c[1], s[2]), signMask);
+            __m128 r02 = s[1];
+            __m128 r03 = _mm_setzero_ps();
+
+            __m128 r10 = _mm_add_ps(_mm_mul_ps(s0s1, c[2]),
+                                    _mm_mul_ps(c[0], s[2]));
+            __m128 r11 = _mm_sub_ps(_mm_mul_ps(c[0], c[2]),
+                                    _mm_mul_ps(s0s1, s[2]));
+            __m128 r12 = _mm_xor_ps(_mm_mul_ps(s[0], c[1]), signMask);
+            __m128 r13 = _mm_setzero_ps();
+
+            __m128 r20 = _mm_sub_ps(_mm_mul_ps(s[0], s[2]),
+                                    _mm_mul_ps(c0s1, c[2]));
+            __m128 r21 = _mm_add_ps(_mm_mul_ps(c0s1, s[2]),
+                                    _mm_mul_ps(s[0], c[2]));
+            __m128 r22 = _mm_mul_ps(c[0], c[1]);
+            __m128 r23 = _mm_setzero_ps();
+
+            // Lanes -> matrices
+            _MM_TRANSPOSE4_PS(r00, r01, r02, r03);
+            _MM_TRANSPOSE4_PS(r10, r11, r12, r13);
+            _MM_TRANSPOSE4_PS(r20, r21, r22, r23);
+
+            const __m128 row3 = _mm_setr_ps(0, 0, 0, 1);
+            const __m128 rows[4][3] = {{r00, r10, r20},
+                                       {r01, r11, r21},
+                                       {r02, r12, r22},
+                                       {r03, r13, r23}};
+            for (unsigned k = 0; k != 4; ++k, out += 16) {
+                _mm_storeu_ps(out, rows[k][0]);
+                _mm_storeu_ps(out + 4, rows[k][1]);
+                _mm_storeu_ps(out + 8, rows[k][2]);
+                _mm_storeu_ps(out + 12, row3);
+            }
+        }
+
+        //! out[i] = Rx(pitch[i]) * Ry(yaw[i]) * Rz(roll[i]); SSE
+        template <sincos_accuracy A>
+        inline void batch_rotate_euler_sse(const float* pitch,
+                                           const float* yaw,
+                                           const float* roll,
+                                           float* out,
+                                           std::size_t count)
+        {
+            const std::size_t body = count - count % 4;
+
+            __m128 s[3];
+            __m128 c[3];
+            for (std::size_t i = 0; i != body; i += 4) {
+                sincos_sse<A>(_mm_loadu_ps(pitch + i), s[0], c[0]);
+                sincos_sse<A>(_mm_loadu_ps(yaw + i), s[1], c[1]);
+                sincos_sse<A>(_mm_loadu_ps(roll + i), s[2], c[2]);
+                batch_euler_store(s, c, out + i * 16);
+            }
+
+            // Tail through zero-padded lanes
+            if (body != count) {
+                const std::size_t tail = count - body;
+
+                float angles[3][4] = {};
+                for (std::size_t i = 0; i != tail; ++i) {
+                    angles[0][i] = pitch[body + i];
+                    angles[1][i] = yaw[body + i];
+                    angles[2][i] = roll[body + i];
+                }
+
+                float buffer[64];
+                for (unsigned k = 0; k != 3; ++k)
+                    sincos_sse<A>(_mm_loadu_ps(angles[k]), s[k], c[k]);
+                batch_euler_store(s, c, buffer);
+
+                for (std::size_t i = 0; i != tail * 16; ++i)
+                    out[body * 16 + i] = buffer[i];
+            }
+        }
+
+        //! out[i] = Rx(pitch[i]) * Ry(yaw[i]) * Rz(roll[i]); AVX2/FMA, 8
+        //! angles per sincos
+        template <sincos_accuracy A>
+        __attribute__((target("avx2,fma"))) inline void
+        batch_rotate_euler_fma(const float* pitch,
+                               const float* yaw,
+                               const float* roll,
+                               float* out,
+                               std::size_t count)
+        {
+            const std::size_t body = count - count % 8;
+
+            for (std::size_t i = 0; i != body; i += 8) {
+                __m256 s[3];
+                __m256 c[3];
+                sincos_fma<A>(_mm256_loadu_ps(pitch + i), s[0], c[0]);
+                sincos_fma<A>(_mm256_loadu_ps(yaw + i), s[1], c[1]);
+                sincos_fma<A>(_mm256_loadu_ps(roll + i), s[2], c[2]);
+
+                const __m128 sLo[3] = {_mm256_castps256_ps128(s[0]),
+                                       _mm256_castps256_ps128(s[1]),
+                                       _mm256_castps256_ps128(s[2])};
+                const __m128 cLo[3] = {_mm256_castps256_ps128(c[0]),
+                                       _mm256_castps256_ps128(c[1]),
+                                       _mm256_castps256_ps128(c[2])};
+                batch_euler_store(sLo, cLo, out + i * 16);
+
+                const __m128 sHi[3] = {_mm256_extractf128_ps(s[0], 1),
+                                       _mm256_extractf128_ps(s[1], 1),
+                                       _mm256_extractf128_ps(s[2], 1)};
+                const __m128 cHi[3] = {_mm256_extractf128_ps(c[0], 1),
+                                       _mm256_extractf128_ps(c[1], 1),
+                                       _mm256_extractf128_ps(c[2], 1)};
+                batch_euler_store(sHi, cHi, out + (i + 4) * 16);
+            }
+
+            batch_rotate_euler_sse<A>(pitch + body,
+                                      yaw + body,
+                                      roll + body,
+                                      out + body * 16,
+                                      count - body);
+        }
+
+        //! Helper
+        //! @return whether sphere i intersects all six planes
+        inline bool batch_cull_lane(const float* planes,
+                                    const float* const spheres[4],
+                                    std::size_t i)
+        {
+            for (unsigned p = 0; p != 24; p += 4) {
+                const float d = planes[p] * spheres[0][i]
+                                + planes[p + 1] * spheres[1][i]
+                                + planes[p + 2] * spheres[2][i] + planes[p + 3];
+                if (d < -spheres[3][i])
+                    return false;
+            }
+            return true;
+        }
+
+        //! Writes the indices of the spheres inside the planes; SSE, 4 lanes
+        //! @return # of indices written
+        inline std::size_t batch_cull_sse(const float* planes,
+                                          const float* const spheres[4],
+                                          unsigned* visible,
+                                          std::size_t count)
+        {
+            const std::size_t body = count - count % 4;
+            unsigned* out = visible;
+
+            std::size_t i = 0;
+            for (; i != body; i += 4) {
+                const __m128 x = _mm_loadu_ps(spheres[0] + i);
+                const __m128 y = _mm_loadu_ps(spheres[1] + i);
+                const __m128 z = _mm_loadu_ps(spheres[2] + i);
+                const __m128 r = _mm_loadu_ps(spheres[3] + i);
+
+                // Distance + radius >= 0 for every plane
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (unsigned p = 0; p != 24; p += 4) {
+                    __m128 d = _mm_add_ps(_mm_set1_ps(planes[p + 3]), r);
+                    d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(planes[p]), x));
+                    d = _mm_add_ps(d,
+                                   _mm_mul_ps(_mm_set1_ps(planes[p + 1]), y));
+                    d = _mm_add_ps(d,
+                                   _mm_mul_ps(_mm_set1_ps(planes[p + 2]), z));
+                    inside = _mm_and_ps(
+                        inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+                }
+
+                for (int mask = _mm_movemask_ps(inside); mask != 0;
+                     mask &= mask - 1)
+                    *out++ = unsigned(i) + __builtin_ctz(mask);
+            }
+
+            for (; i < count; ++i) {
+                if (batch_cull_lane(planes, spheres, i))
+                    *out++ = unsigned(i);
+            }
+            return out - visible;
+        }
+
+        //! As batch_cull_sse(); AVX2/FMA, 8 lanes
+        __attribute__((target("avx2,fma"))) inline std::size_t
+        batch_cull_fma(const float* planes,
+                       const float* const spheres[4],
+                       unsigned* visible,
+                       std::size_t count)
+        {
+            __m256 coef[24];
+            for (unsigned p = 0; p != 24; ++p)
+                coef[p] = _mm256_set1_ps(planes[p]);
+
+            const std::size_t body = count - count % 8;
+            unsigned* out = visible;
+
+            std::size_t i = 0;
+            for (; i != body; i += 8) {
+                const __m256 x = _mm256_loadu_ps(spheres[0] + i);
+                const __m256 y = _mm256_loadu_ps(spheres[1] + i);
+                const __m256 z = _mm256_loadu_ps(spheres[2] + i);
+                const __m256 r = _mm256_loadu_ps(spheres[3] + i);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (unsigned p = 0; p != 24; p += 4) {
+                    __m256 d = _mm256_add_ps(coef[p + 3], r);
+                    d = _mm256_fmadd_ps(coef[p], x, d);
+                    d = _mm256_fmadd_ps(coef[p + 1], y, d);
+                    d = _mm256_fmadd_ps(coef[p + 2], z, d);
+                    inside = _mm256_and_ps(
+                        inside,
+                        _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+                }
+
+                for (int mask = _mm256_movemask_ps(inside); mask != 0;
+                     mask &= mask - 1)
+                    *out++ = unsigned(i) + __builtin_ctz(mask);
+            }
+
+            for (; i < count; ++i) {
+                if (batch_cull_lane(planes, spheres, i))
+                    *out++ = unsigned(i);
+            }
+            return out - visible;
+        }
+    } // namespace detail
+
+    //! functor batch_mul
+    /*! SIMD products of a fixed matrix with an array of packed row-major 4x4
+     *! matrices
+     */
+    struct batch_mul {
+        //! out[i] = lhs * in[i]
+        static inline void lhs(const float* lhs,
+                               const float* in,
+                               float* out,
+                               std::size_t count)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::batch_mul_lhs_fma(lhs, in, out, count);
+#else
+            if (cpu::has_avx2_fma())
+                detail::batch_mul_lhs_fma(lhs, in, out, count);
+            else
+                detail::batch_mul_lhs_sse(lhs, in, out, count);
+#endif
+        }
+
+        //! out[i] = in[i] * rhs
+        static inline void rhs(const float* in,
+                               const float* rhs,
+                               float* out,
+                               std::size_t count)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::batch_mul_rhs_fma(in, rhs, out, count);
+#else
+            if (cpu::has_avx2_fma())
+                detail::batch_mul_rhs_fma(in, rhs, out, count);
+            else
+                detail::batch_mul_rhs_sse(in, rhs, out, count);
+#endif
+        }
+    };
+
+    //! functor batch_transform
+    /*! SIMD products of a fixed 4x4 matrix with an array of 4-vectors
+     */
+    struct batch_transform {
+        //! Packed (xyzw, xyzw, ...) vectors
+        static inline void aos(const float* m,
+                               const float* in,
+                               float* out,
+                               std::size_t count)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::batch_transform_aos_fma(m, in, out, count);
+#else
+            if (cpu::has_avx2_fma())
+                detail::batch_transform_aos_fma(m, in, out, count);
+            else
+                detail::batch_transform_aos_sse(m, in, out, count);
+#endif
+        }
+
+        //! Separate x, y, z and w arrays
+        static inline void soa(const float* m,
+                               const float* const in[4],
+                               float* const out[4],
+                               std::size_t count)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::batch_transform_soa_fma(m, in, out, count);
+#else
+            if (cpu::has_avx2_fma())
+                detail::batch_transform_soa_fma(m, in, out, count);
+            else
+                detail::batch_transform_soa_sse(m, in, out, count);
+#endif
+        }
+    };
+
+    //! functor batch_translate
+    /*! Writes translation(x[i], y[i], z[i]) * model for an array of offsets
+     */
+    struct batch_translate {
+        static inline void translate(const float* model,
+                                     const float* x,
+                                     const float* y,
+                                     const float* z,
+                                     float* out,
+                                     std::size_t count)
+        {
+            const __m128 m0 = _mm_loadu_ps(model);
+            const __m128 m1 = _mm_loadu_ps(model + 4);
+            const __m128 m2 = _mm_loadu_ps(model + 8);
+            const __m128 m3 = _mm_loadu_ps(model + 12);
+
+            for (std::size_t i = 0; i != count; ++i, out += 16) {
+                const __m128 tx = _mm_mul_ps(_mm_set1_ps(x[i]), m3);
+                const __m128 ty = _mm_mul_ps(_mm_set1_ps(y[i]), m3);
+                const __m128 tz = _mm_mul_ps(_mm_set1_ps(z[i]), m3);
+
+                _mm_storeu_ps(out, _mm_add_ps(m0, tx));
+                _mm_storeu_ps(out + 4, _mm_add_ps(m1, ty));
+                _mm_storeu_ps(out + 8, _mm_add_ps(m2, tz));
+                _mm_storeu_ps(out + 12, m3);
+            }
+        }
+
+        //! As translate(), storing each result column-major. Column j of
+        //! translation(t) * model is column j of model plus model(3, j) * t,
+        //! so the columns are built directly, with no transpose per matrix
+        static inline void translate_transposed(const float* model,
+                                                const float* x,
+                                                const float* y,
+                                                const float* z,
+                                                float* out,
+                                                std::size_t count)
+        {
+            __m128 c0 = _mm_loadu_ps(model);
+            __m128 c1 = _mm_loadu_ps(model + 4);
+            __m128 c2 = _mm_loadu_ps(model + 8);
+            __m128 c3 = _mm_loadu_ps(model + 12);
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+            const __m128 w0 = _mm_set1_ps(model[12]);
+            const __m128 w1 = _mm_set1_ps(model[13]);
+            const __m128 w2 = _mm_set1_ps(model[14]);
+            const __m128 w3 = _mm_set1_ps(model[15]);
+
+            for (std::size_t i = 0; i != count; ++i, out += 16) {
+                const __m128 t = _mm_setr_ps(x[i], y[i], z[i], 0);
+
+                _mm_storeu_ps(out, _mm_add_ps(c0, _mm_mul_ps(w0, t)));
+                _mm_storeu_ps(out + 4, _mm_add_ps(c1, _mm_mul_ps(w1, t)));
+                _mm_storeu_ps(out + 8, _mm_add_ps(c2, _mm_mul_ps(w2, t)));
+                _mm_storeu_ps(out + 12, _mm_add_ps(c3, _mm_mul_ps(w3, t)));
+            }
+        }
+    };
+
+    //! functor batch_transpose
+    /*! Transposes an array of packed 4x4 matrices, e.g. into device order
+     */
+    struct batch_transpose {
+        static inline void transpose(const float* in,
+                                     float* out,
+                                     std::size_t count)
+        {
+            for (std::size_t i = 0; i != count * 16; i += 16)
+                matrix_transpose<float, 4>::transpose(in + i, out + i);
+        }
+    };
+
+    //! functor batch_cull
+    /*! Tests arrays of bounding spheres against six planes, writing the
+     *! indices of the spheres not entirely outside any plane
+     */
+    struct batch_cull {
+        //! @param planes
+        //!     Six (a, b, c, d) planes, normals pointing inward
+        //! @param spheres
+        //!     Separate center x, y, z and radius arrays
+        //! @return
+        //!     # of indices written to `visible`, in ascending order
+        static inline std::size_t cull(const float* planes,
+                                       const float* const spheres[4],
+                                       unsigned* visible,
+                                       std::size_t count)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            return detail::batch_cull_fma(planes, spheres, visible, count);
+#else
+            if (cpu::has_avx2_fma())
+                return detail::batch_cull_fma(
+                    planes, spheres, visible, count);
+            return detail::batch_cull_sse(planes, spheres, visible, count);
+#endif
+        }
+    };
+
+    //! functor batch_rotate_euler
+    /*! Builds Rx(pitch) * Ry(yaw) * Rz(roll) rotation matrices for arrays of
+     *! angles, with the sines/cosines computed in SIMD lanes
+     */
+    template <sincos_accuracy A = sincos_accuracy::precise>
+    struct batch_rotate_euler {
+        static inline void rotate(const float* pitch,
+                                  const float* yaw,
+                                  const float* roll,
+                                  float* out,
+                                  std::size_t count)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::batch_rotate_euler_fma<A>(pitch, yaw, roll, out, count);
+#else
+            if (cpu::has_avx2_fma())
+                detail::batch_rotate_euler_fma<A>(
+                    pitch, yaw, roll, out, count);
+            else
+                detail::batch_rotate_euler_sse<A>(
+                    pitch, yaw, roll, out, count);
+#endif
+        }
+    };
+} // namespace calc
+
+#endif
@@ -3,6 +3,7 @@
 #ifndef _CALC_SIMD_COMMON_HPP
 #define _CALC_SIMD_COMMON_HPP
 
+#include <cstddef>
 #include <immintrin.h>
 
 #define __stride__(a) (16 / (a))
@@ -38,6 +39,18 @@ namespace calc {
 
         template <> inline void store(float* dat, __m128 fill) { _mm_store_ps(dat, fill); }
         template <> inline void store(double* dat, __m128d fill) { _mm_store_pd(dat, fill); }
+
+        //! Calls `fn(offset)` for the offset of each 16 byte register over
+        //! `size` elements of U. A size that is not a multiple of the lane
+        //! count still takes a whole last pass, which runs into the padding
+        //! the matrix buffers carry up to a register multiple.
+        template <typename U, typename Fn>
+        inline void for_each_register(std::size_t size, Fn&& fn)
+        {
+            std::size_t ii = 0;
+            for ( ; ii < size; ii += __stride__(sizeof(U)))
+                fn(ii);
+        }
     }
 }
 
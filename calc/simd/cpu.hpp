@@ -0,0 +1,26 @@
+#pragma once
+
+#ifndef _CALC_SIMD_CPU_HPP
+#define _CALC_SIMD_CPU_HPP
+
+namespace calc {
+
+    namespace cpu {
+
+        //! @return
+        //!     True if the host CPU supports AVX2 and FMA3; queried through
+        //!     CPUID once and cached
+        inline bool has_avx2_fma()
+        {
+            static const bool supported = []() {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2")
+                       && __builtin_cpu_supports("fma");
+            }();
+
+            return supported;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,512 @@
+#pragma once
+
+#ifndef _CALC_SIMD_GEMM_HPP
+#define _CALC_SIMD_GEMM_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "cpu.hpp"
+#include "scratch.hpp"
+
+namespace calc {
+
+    namespace detail {
+
+        // Cache blocking: a KCxNC panel of B stays in L3, an MCxKC block of
+        // A in L2 and a KCxNR sliver of B in L1
+        static const std::size_t kGemmMC = 96;
+        static const std::size_t kGemmKC = 256;
+        static const std::size_t kGemmNC = 2048;
+
+        // # of multiply-adds above which the product is split across threads
+        static const std::size_t kGemmParallelThreshold = std::size_t(1) << 24;
+
+        //! Helper
+        //! Writes an MRxNR accumulator tile to C, clipped to mr x nr
+        template <unsigned MR, unsigned NR>
+        inline void gemm_store_tile(const float* acc,
+                                    float* c,
+                                    std::size_t ldc,
+                                    unsigned mr,
+                                    unsigned nr,
+                                    bool accumulate)
+        {
+            for (unsigned r = 0; r != mr; ++r) {
+                float* row = c + r * ldc;
+                if (accumulate) {
+                    for (unsigned j = 0; j != nr; ++j)
+                        row[j] += acc[r * NR + j];
+                } else {
+                    for (unsigned j = 0; j != nr; ++j)
+                        row[j] = acc[r * NR + j];
+                }
+            }
+        }
+
+        //! SSE micro-kernel; 4x8 tile of C from packed A and B slivers
+        inline void gemm_kernel_sse(std::size_t kc,
+                                    const float* a,
+                                    const float* b,
+                                    float* c,
+                                    std::size_t ldc,
+                                    unsigned mr,
+                                    unsigned nr,
+                                    bool accumulate)
+        {
+            __m128 acc[4][2];
+            for (unsigned r = 0; r != 4; ++r)
+                acc[r][0] = acc[r][1] = _mm_setzero_ps();
+
+            for (std::size_t p = 0; p != kc; ++p, a += 4, b += 8) {
+                const __m128 b0 = _mm_load_ps(b);
+                const __m128 b1 = _mm_load_ps(b + 4);
+
+                for (unsigned r = 0; r != 4; ++r) {
+                    const __m128 ar = _mm_set1_ps(a[r]);
+                    acc[r][0] = _mm_add_ps(acc[r][0], _mm_mul_ps(ar, b0));
+                    acc[r][1] = _mm_add_ps(acc[r][1], _mm_mul_ps(ar, b1));
+                }
+            }
+
+            if (mr == 4 && nr == 8) {
+                for (unsigned r = 0; r != 4; ++r) {
+                    float* row = c + r * ldc;
+                    if (accumulate) {
+                        acc[r][0] = _mm_add_ps(acc[r][0], _mm_loadu_ps(row));
+                        acc[r][1] = _mm_add_ps(acc[r][1], _mm_loadu_ps(row + 4));
+                    }
+
+                    _mm_storeu_ps(row, acc[r][0]);
+                    _mm_storeu_ps(row + 4, acc[r][1]);
+                }
+            } else {
+                float tile[4 * 8] __attribute__((aligned(16)));
+                for (unsigned r = 0; r != 4; ++r) {
+                    _mm_store_ps(tile + r * 8, acc[r][0]);
+                    _mm_store_ps(tile + r * 8 + 4, acc[r][1]);
+                }
+
+                gemm_store_tile<4, 8>(tile, c, ldc, mr, nr, accumulate);
+            }
+        }
+
+        //! AVX2/FMA micro-kernel; 6x16 tile of C from packed A and B slivers
+        __attribute__((target("avx2,fma"))) inline void gemm_kernel_fma(
+            std::size_t kc,
+            const float* a,
+            const float* b,
+            float* c,
+            std::size_t ldc,
+            unsigned mr,
+            unsigned nr,
+            bool accumulate)
+        {
+            __m256 acc[6][2];
+            for (unsigned r = 0; r != 6; ++r)
+                acc[r][0] = acc[r][1] = _mm256_setzero_ps();
+
+            for (std::size_t p = 0; p != kc; ++p, a += 6, b += 16) {
+                const __m256 b0 = _mm256_load_ps(b);
+                const __m256 b1 = _mm256_load_ps(b + 8);
+
+                for (unsigned r = 0; r != 6; ++r) {
+                    const __m256 ar = _mm256_broadcast_ss(a + r);
+                    acc[r][0] = _mm256_fmadd_ps(ar, b0, acc[r][0]);
+                    acc[r][1] = _mm256_fmadd_ps(ar, b1, acc[r][1]);
+                }
+            }
+
+            if (mr == 6 && nr == 16) {
+                for (unsigned r = 0; r != 6; ++r) {
+                    float* row = c + r * ldc;
+                    if (accumulate) {
+                        acc[r][0] = _mm256_add_ps(acc[r][0], _mm256_loadu_ps(row));
+                        acc[r][1] = _mm256_add_ps(acc[r][1],
+                                                  _mm256_loadu_ps(row + 8));
+                    }
+
+                    _mm256_storeu_ps(row, acc[r][0]);
+                    _mm256_storeu_ps(row + 8, acc[r][1]);
+                }
+            } else {
+                float tile[6 * 16] __attribute__((aligned(32)));
+                for (unsigned r = 0; r != 6; ++r) {
+                    _mm256_store_ps(tile + r * 16, acc[r][0]);
+                    _mm256_store_ps(tile + r * 16 + 8, acc[r][1]);
+                }
+
+                gemm_store_tile<6, 16>(tile, c, ldc, mr, nr, accumulate);
+            }
+        }
+
+        //! Helper
+        //! Packs an mc x kc block of A into MR-row slivers, k-major, zero
+        //! padding the last sliver
+        template <unsigned MR>
+        inline void gemm_pack_a(const float* a,
+                                std::size_t lda,
+                                std::size_t mc,
+                                std::size_t kc,
+                                float* out)
+        {
+            for (std::size_t i = 0; i < mc; i += MR) {
+                const unsigned mr = std::min<std::size_t>(MR, mc - i);
+                for (std::size_t p = 0; p != kc; ++p) {
+                    unsigned r = 0;
+                    for (; r != mr; ++r)
+                        *out++ = a[(i + r) * lda + p];
+                    for (; r != MR; ++r)
+                        *out++ = 0;
+                }
+            }
+        }
+
+        //! Helper
+        //! Packs a kc x nc panel of B into NR-column slivers, zero padding the
+        //! last sliver
+        template <unsigned NR>
+        inline void gemm_pack_b(const float* b,
+                                std::size_t ldb,
+                                std::size_t kc,
+                                std::size_t nc,
+                                float* out)
+        {
+            for (std::size_t j = 0; j < nc; j += NR) {
+                const unsigned nr = std::min<std::size_t>(NR, nc - j);
+                for (std::size_t p = 0; p != kc; ++p) {
+                    const float* row = b + p * ldb + j;
+                    unsigned c = 0;
+                    for (; c != nr; ++c)
+                        *out++ = row[c];
+                    for (; c != NR; ++c)
+                        *out++ = 0;
+                }
+            }
+        }
+
+        typedef void (*gemm_kernel_fn)(std::size_t,
+                                       const float*,
+                                       const float*,
+                                       float*,
+                                       std::size_t,
+                                       unsigned,
+                                       unsigned,
+                                       bool);
+
+        //! Cache-blocked, register-tiled product C(m x n) = A(m x k) * B(k x n)
+        //! of row-major matrices; packing buffers come from the calling
+        //! thread's scratch arena
+        template <unsigned MR, unsigned NR, gemm_kernel_fn Kernel>
+        void gemm_blocked(const float* a,
+                          const float* b,
+                          float* c,
+                          std::size_t m,
+                          std::size_t k,
+                          std::size_t n,
+                          std::size_t lda,
+                          std::size_t ldb,
+                          std::size_t ldc)
+        {
+            static_assert(kGemmMC % MR == 0 && kGemmNC % NR == 0);
+
+            const std::size_t mcMax = std::min(kGemmMC, (m + MR - 1) / MR * MR);
+            const std::size_t ncMax = std::min(kGemmNC, (n + NR - 1) / NR * NR);
+            const std::size_t kcMax = std::min(kGemmKC, k);
+
+            // Packed B panel first; keeps both buffers 64-byte aligned
+            float* packedB = scratch_arena::local().acquire(
+                kcMax * (ncMax + mcMax) + 16);
+            float* packedA = packedB + (kcMax * ncMax + 15) / 16 * 16;
+
+            for (std::size_t jc = 0; jc < n; jc += kGemmNC) {
+                const std::size_t nc = std::min(kGemmNC, n - jc);
+
+                for (std::size_t pc = 0; pc < k; pc += kGemmKC) {
+                    const std::size_t kc = std::min(kGemmKC, k - pc);
+                    gemm_pack_b<NR>(b + pc * ldb + jc, ldb, kc, nc, packedB);
+
+                    for (std::size_t ic = 0; ic < m; ic += kGemmMC) {
+                        const std::size_t mc = std::min(kGemmMC, m - ic);
+                        gemm_pack_a<MR>(a + ic * lda + pc, lda, mc, kc, packedA);
+
+                        for (std::size_t jr = 0; jr < nc; jr += NR) {
+                            const unsigned nr = std::min<std::size_t>(NR, nc - jr);
+                            for (std::size_t ir = 0; ir < mc; ir += MR) {
+                                const unsigned mr
+                                    = std::min<std::size_t>(MR, mc - ir);
+                                Kernel(kc,
+                                       packedA + ir * kc,
+                                       packedB + jr * kc,
+                                       c + (ic + ir) * ldc + jc + jr,
+                                       ldc,
+                                       mr,
+                                       nr,
+                                       pc != 0);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        typedef void (*gemm_fn)(const float*,
+                                const float*,
+                                float*,
+                                std::size_t,
+                                std::size_t,
+                                std::size_t,
+                                std::size_t,
+                                std::size_t,
+                                std::size_t);
+
+        //! class gemm_pool
+        /*! Helper threads for the threaded product, started on first use
+         *! and kept for the life of the program, so a product neither
+         *! creates threads nor allocates; each keeps its scratch_arena warm
+         */
+        class gemm_pool {
+        public:
+            //! @return
+            //!     Process-wide pool, one helper per hardware thread but one
+            static gemm_pool& instance()
+            {
+                static gemm_pool pool;
+                return pool;
+            }
+
+            //! Dtor.
+            ~gemm_pool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                wake_.notify_all();
+                for (std::thread& refthread : threads_)
+                    refthread.join();
+            }
+
+            gemm_pool(const gemm_pool&) = delete;
+            gemm_pool& operator=(const gemm_pool&) = delete;
+
+            //! @return
+            //!     # of helper threads
+            unsigned helpers() const
+            {
+                return unsigned(threads_.size());
+            }
+
+            //! Runs fn(i) for every i in [0, count), fn(0) on the calling
+            //! thread, and returns once all are done
+            //! @param count
+            //!     At most helpers() + 1
+            //! @return
+            //!     false, without running anything, while another thread's
+            //!     product holds the pool
+            template <typename Fn>
+            bool try_run(unsigned count, const Fn& fn)
+            {
+                std::unique_lock<std::mutex> busy(busy_, std::try_to_lock);
+                if (!busy.owns_lock())
+                    return false;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    call_ = [](const void* f, unsigned i) {
+                        (*static_cast<const Fn*>(f))(i);
+                    };
+                    fn_ = &fn;
+                    next_ = 1;
+                    count_ = count;
+                    pending_ = count - 1;
+                }
+                wake_.notify_all();
+
+                fn(0);
+
+                std::unique_lock<std::mutex> lock(mutex_);
+                done_.wait(lock, [this] { return pending_ == 0; });
+                return true;
+            }
+        private:
+            //! Ctor.
+            gemm_pool()
+            {
+                const unsigned count
+                    = std::max(1U, std::thread::hardware_concurrency()) - 1;
+                threads_.reserve(count);
+                for (unsigned i = 0; i != count; ++i)
+                    threads_.emplace_back(&gemm_pool::work, this);
+            }
+
+            //! Helper loop; takes parts until none are left
+            void work()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for (;;) {
+                    wake_.wait(lock,
+                               [this] { return stop_ || next_ < count_; });
+                    if (stop_)
+                        return;
+
+                    const unsigned i = next_++;
+                    lock.unlock();
+                    call_(fn_, i);
+                    lock.lock();
+
+                    if (--pending_ == 0)
+                        done_.notify_one();
+                }
+            }
+
+            // Held by the product using the pool
+            std::mutex busy_;
+            // Guards the fields below
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::condition_variable done_;
+            // Current job: fn_ called through call_ for parts [1, count_)
+            void (*call_)(const void*, unsigned) = nullptr;
+            const void* fn_ = nullptr;
+            unsigned next_ = 0;
+            unsigned count_ = 0;
+            unsigned pending_ = 0;
+            bool stop_ = false;
+            std::vector<std::thread> threads_;
+        };
+
+        //! @return
+        //!     Fastest blocked product supported by the host CPU
+        inline gemm_fn select_gemm()
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            return &gemm_blocked<6, 16, &gemm_kernel_fma>;
+#else
+            return cpu::has_avx2_fma() ? &gemm_blocked<6, 16, &gemm_kernel_fma>
+                                       : &gemm_blocked<4, 8, &gemm_kernel_sse>;
+#endif
+        }
+
+        //! C(m x n) = A(m x k) * B(k x n), row-major and densely packed;
+        //! C must not alias A or B
+        //! @param threads
+        //!     Worker count, capped by gemm_pool; 0 picks one automatically
+        //!     from the problem size. A product started while another thread
+        //!     uses the pool runs on the calling thread alone.
+        inline void gemm(const float* a,
+                         const float* b,
+                         float* c,
+                         std::size_t m,
+                         std::size_t k,
+                         std::size_t n,
+                         unsigned threads = 0)
+        {
+            if (m == 0 || n == 0)
+                return;
+
+            if (k == 0) {
+                std::fill(c, c + m * n, 0.0F);
+                return;
+            }
+
+            static const gemm_fn kernel = select_gemm();
+
+            if (threads == 0) {
+                threads = 1;
+                if (m * k * n >= kGemmParallelThreshold) {
+                    threads = std::max(1U, std::thread::hardware_concurrency());
+                }
+            }
+
+            // Whole row blocks per worker; each packs its own A and B
+            const std::size_t blocks = (m + kGemmMC - 1) / kGemmMC;
+            threads = std::min<std::size_t>(threads, blocks);
+
+            if (threads > 1) {
+                gemm_pool& refpool = gemm_pool::instance();
+                threads = std::min(threads, refpool.helpers() + 1);
+
+                const std::size_t rows
+                    = (blocks + threads - 1) / threads * kGemmMC;
+                const auto part = [&](unsigned i) {
+                    const std::size_t first = i * rows;
+                    if (first < m)
+                        kernel(a + first * k,
+                               b,
+                               c + first * n,
+                               std::min(rows, m - first),
+                               k,
+                               n,
+                               k,
+                               n,
+                               n);
+                };
+
+                if (threads > 1 && refpool.try_run(threads, part))
+                    return;
+            }
+
+            kernel(a, b, c, m, k, n, k, n, n);
+        }
+
+        //! out(m) = A(m x k) * v(k), row-major and densely packed; out must
+        //! not alias A or v
+        inline void gemv(const float* a,
+                         const float* v,
+                         float* out,
+                         std::size_t m,
+                         std::size_t k)
+        {
+            // Four rows per pass share each load of v
+            std::size_t i = 0;
+            for (; i + 4 <= m; i += 4) {
+                const float* r0 = a + i * k;
+                const float* r1 = r0 + k;
+                const float* r2 = r1 + k;
+                const float* r3 = r2 + k;
+
+                __m128 s0 = _mm_setzero_ps();
+                __m128 s1 = _mm_setzero_ps();
+                __m128 s2 = _mm_setzero_ps();
+                __m128 s3 = _mm_setzero_ps();
+
+                std::size_t p = 0;
+                for (; p + 4 <= k; p += 4) {
+                    const __m128 x = _mm_loadu_ps(v + p);
+                    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(r0 + p), x));
+                    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(r1 + p), x));
+                    s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(r2 + p), x));
+                    s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(r3 + p), x));
+                }
+
+                // Reduce: lane j of the result is the sum of s_j
+                _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+                __m128 sum = _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3));
+
+                for (; p != k; ++p) {
+                    const __m128 col = _mm_setr_ps(r0[p], r1[p], r2[p], r3[p]);
+                    sum = _mm_add_ps(sum, _mm_mul_ps(col, _mm_set1_ps(v[p])));
+                }
+
+                _mm_storeu_ps(out + i, sum);
+            }
+
+            for (; i != m; ++i) {
+                const float* row = a + i * k;
+
+                float sum = 0;
+                for (std::size_t p = 0; p != k; ++p)
+                    sum += row[p] * v[p];
+                out[i] = sum;
+            }
+        }
+    } // namespace detail
+} // namespace calc
+
+#endif
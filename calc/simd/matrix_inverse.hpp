@@ -0,0 +1,378 @@
+#pragma once
+
+#ifndef _CALC_SIMD_MATRIX_INVERSE_HPP
+#define _CALC_SIMD_MATRIX_INVERSE_HPP
+
+#include <cstddef>
+
+#include "common.hpp"
+#include "cpu.hpp"
+
+namespace calc {
+
+    namespace detail {
+
+        //! Helper
+        //! 2x2 block product A * B, blocks held row-major in one register
+        inline __m128 mat2_mul(const __m128 a, const __m128 b)
+        {
+            return _mm_add_ps(
+                _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+                _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                           _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+        }
+
+        //! Helper
+        //! 2x2 block product adj(A) * B
+        inline __m128 mat2_adj_mul(const __m128 a, const __m128 b)
+        {
+            return _mm_sub_ps(
+                _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+                _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)),
+                           _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+
+        //! Helper
+        //! 2x2 block product A * adj(B)
+        inline __m128 mat2_mul_adj(const __m128 a, const __m128 b)
+        {
+            return _mm_sub_ps(
+                _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+                _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                           _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+        }
+
+        //! General 4x4 inverse; SSE
+        /*! Splits the matrix into 2x2 blocks | A B ; C D | and assembles the
+         *! inverse from block adjugates, so only one division is needed.
+         *! Singular input yields inf/nan, like the scalar path
+         */
+        inline void matrix_inverse_4x4_sse(const float* in, float* out)
+        {
+            const __m128 r0 = _mm_loadu_ps(in);
+            const __m128 r1 = _mm_loadu_ps(in + 4);
+            const __m128 r2 = _mm_loadu_ps(in + 8);
+            const __m128 r3 = _mm_loadu_ps(in + 12);
+
+            // Blocks
+            const __m128 a = _mm_movelh_ps(r0, r1);
+            const __m128 b = _mm_movehl_ps(r1, r0);
+            const __m128 c = _mm_movelh_ps(r2, r3);
+            const __m128 d = _mm_movehl_ps(r3, r2);
+
+            // (|A|, |B|, |C|, |D|)
+            const __m128 detSub = _mm_sub_ps(
+                _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)),
+                           _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+                _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)),
+                           _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+            const __m128 detA
+                = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m128 detB
+                = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1, 1, 1, 1));
+            const __m128 detC
+                = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2, 2, 2, 2));
+            const __m128 detD
+                = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3, 3, 3, 3));
+
+            const __m128 dc = mat2_adj_mul(d, c);
+            const __m128 ab = mat2_adj_mul(a, b);
+
+            // Adjugates of the inverse's blocks
+            __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mat2_mul(b, dc));
+            __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mat2_mul(c, ab));
+            __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mat2_mul_adj(d, ab));
+            __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mat2_mul_adj(a, dc));
+
+            // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+            __m128 tr = _mm_mul_ps(
+                ab, _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(3, 1, 2, 0)));
+            tr = _mm_add_ps(tr,
+                            _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+            tr = _mm_add_ps(tr,
+                            _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+
+            __m128 det = _mm_add_ps(_mm_mul_ps(detA, detD),
+                                    _mm_mul_ps(detB, detC));
+            det = _mm_sub_ps(det, tr);
+
+            const __m128 rdet = _mm_div_ps(_mm_setr_ps(1, -1, -1, 1), det);
+            x = _mm_mul_ps(x, rdet);
+            y = _mm_mul_ps(y, rdet);
+            z = _mm_mul_ps(z, rdet);
+            w = _mm_mul_ps(w, rdet);
+
+            // Undo the adjugate swizzle while interleaving the blocks
+            _mm_storeu_ps(out, _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+            _mm_storeu_ps(out + 4,
+                          _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+            _mm_storeu_ps(out + 8,
+                          _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+            _mm_storeu_ps(out + 12,
+                          _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+        }
+
+        //! Helper
+        //! @return a row of matrix `lo` and the same row of matrix `hi` in
+        //!     the low and high halves of one register
+        __attribute__((target("avx2,fma"))) inline __m256 load2x4(
+            const float* lo, const float* hi)
+        {
+            return _mm256_insertf128_ps(
+                _mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+        }
+
+        //! Helper
+        //! Broadcasts lane `i` within each 128-bit half
+        template <int i>
+        __attribute__((target("avx2,fma"))) inline __m256 splat2x4(
+            const __m256 v)
+        {
+            return _mm256_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i));
+        }
+
+        //! Helper
+        //! _mm_movelh_ps within each 128-bit half
+        __attribute__((target("avx2,fma"))) inline __m256 movelh2x4(
+            const __m256 u, const __m256 v)
+        {
+            return _mm256_castpd_ps(
+                _mm256_unpacklo_pd(_mm256_castps_pd(u), _mm256_castps_pd(v)));
+        }
+
+        //! Helper
+        //! _mm_movehl_ps within each 128-bit half
+        __attribute__((target("avx2,fma"))) inline __m256 movehl2x4(
+            const __m256 u, const __m256 v)
+        {
+            return _mm256_castpd_ps(
+                _mm256_unpackhi_pd(_mm256_castps_pd(v), _mm256_castps_pd(u)));
+        }
+
+        //! Helper
+        //! mat2_mul over two pairs of blocks
+        __attribute__((target("avx2,fma"))) inline __m256 mat2_mul_x2(
+            const __m256 a, const __m256 b)
+        {
+            return _mm256_fmadd_ps(
+                a,
+                _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0)),
+                _mm256_mul_ps(
+                    _mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                    _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+        }
+
+        //! Helper
+        //! mat2_adj_mul over two pairs of blocks
+        __attribute__((target("avx2,fma"))) inline __m256 mat2_adj_mul_x2(
+            const __m256 a, const __m256 b)
+        {
+            return _mm256_fmsub_ps(
+                _mm256_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)),
+                b,
+                _mm256_mul_ps(
+                    _mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)),
+                    _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+
+        //! Helper
+        //! mat2_mul_adj over two pairs of blocks
+        __attribute__((target("avx2,fma"))) inline __m256 mat2_mul_adj_x2(
+            const __m256 a, const __m256 b)
+        {
+            return _mm256_fmsub_ps(
+                a,
+                _mm256_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3)),
+                _mm256_mul_ps(
+                    _mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                    _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+        }
+
+        //! General 4x4 inverse of two matrices at once; AVX2/FMA
+        /*! Same block scheme as the SSE kernel, with one matrix per 128-bit
+         *! half; every shuffle stays within its half
+         */
+        __attribute__((target("avx2,fma"))) inline void
+        matrix_inverse_4x4_fma_x2(const float* in, float* out)
+        {
+            const __m256 r0 = load2x4(in, in + 16);
+            const __m256 r1 = load2x4(in + 4, in + 20);
+            const __m256 r2 = load2x4(in + 8, in + 24);
+            const __m256 r3 = load2x4(in + 12, in + 28);
+
+            // Blocks
+            const __m256 a = movelh2x4(r0, r1);
+            const __m256 b = movehl2x4(r1, r0);
+            const __m256 c = movelh2x4(r2, r3);
+            const __m256 d = movehl2x4(r3, r2);
+
+            // (|A|, |B|, |C|, |D|) per half
+            const __m256 detSub = _mm256_fmsub_ps(
+                _mm256_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)),
+                _mm256_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1)),
+                _mm256_mul_ps(
+                    _mm256_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)),
+                    _mm256_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+            const __m256 detA = splat2x4<0>(detSub);
+            const __m256 detB = splat2x4<1>(detSub);
+            const __m256 detC = splat2x4<2>(detSub);
+            const __m256 detD = splat2x4<3>(detSub);
+
+            const __m256 dc = mat2_adj_mul_x2(d, c);
+            const __m256 ab = mat2_adj_mul_x2(a, b);
+
+            // Adjugates of the inverse's blocks
+            __m256 x
+                = _mm256_sub_ps(_mm256_mul_ps(detD, a), mat2_mul_x2(b, dc));
+            __m256 w
+                = _mm256_sub_ps(_mm256_mul_ps(detA, d), mat2_mul_x2(c, ab));
+            __m256 y
+                = _mm256_sub_ps(_mm256_mul_ps(detB, c), mat2_mul_adj_x2(d, ab));
+            __m256 z
+                = _mm256_sub_ps(_mm256_mul_ps(detC, b), mat2_mul_adj_x2(a, dc));
+
+            __m256 tr = _mm256_mul_ps(
+                ab, _mm256_shuffle_ps(dc, dc, _MM_SHUFFLE(3, 1, 2, 0)));
+            tr = _mm256_add_ps(
+                tr, _mm256_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+            tr = _mm256_add_ps(
+                tr, _mm256_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+
+            const __m256 det = _mm256_sub_ps(
+                _mm256_fmadd_ps(detA, detD, _mm256_mul_ps(detB, detC)), tr);
+
+            const __m256 rdet = _mm256_div_ps(
+                _mm256_setr_ps(1, -1, -1, 1, 1, -1, -1, 1), det);
+            x = _mm256_mul_ps(x, rdet);
+            y = _mm256_mul_ps(y, rdet);
+            z = _mm256_mul_ps(z, rdet);
+            w = _mm256_mul_ps(w, rdet);
+
+            const __m256 o0 = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3));
+            const __m256 o1 = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2));
+            const __m256 o2 = _mm256_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3));
+            const __m256 o3 = _mm256_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2));
+
+            _mm_storeu_ps(out, _mm256_castps256_ps128(o0));
+            _mm_storeu_ps(out + 4, _mm256_castps256_ps128(o1));
+            _mm_storeu_ps(out + 8, _mm256_castps256_ps128(o2));
+            _mm_storeu_ps(out + 12, _mm256_castps256_ps128(o3));
+            _mm_storeu_ps(out + 16, _mm256_extractf128_ps(o0, 1));
+            _mm_storeu_ps(out + 20, _mm256_extractf128_ps(o1, 1));
+            _mm_storeu_ps(out + 24, _mm256_extractf128_ps(o2, 1));
+            _mm_storeu_ps(out + 28, _mm256_extractf128_ps(o3, 1));
+        }
+
+        //! Inverse of an array of matrices; SSE
+        inline void matrix_inverse_4x4_array_sse(const float* in,
+                                                 float* out,
+                                                 std::size_t count)
+        {
+            for (std::size_t i = 0; i != count; ++i)
+                matrix_inverse_4x4_sse(in + i * 16, out + i * 16);
+        }
+
+        //! Inverse of an array of matrices; AVX2/FMA, two per pass
+        __attribute__((target("avx2,fma"))) inline void
+        matrix_inverse_4x4_array_fma(const float* in,
+                                     float* out,
+                                     std::size_t count)
+        {
+            std::size_t i = 0;
+            for (; i + 2 <= count; i += 2)
+                matrix_inverse_4x4_fma_x2(in + i * 16, out + i * 16);
+            if (i != count)
+                matrix_inverse_4x4_sse(in + i * 16, out + i * 16);
+        }
+
+        //! Inverse of | R t ; 0 1 | where the columns of R are orthogonal
+        //! (rotation times scale); SSE
+        /*! The inverse is | R' -R't ; 0 1 | with column k of R' equal to row
+         *! k of R scaled by 1/|column|^2, so no determinant is needed
+         */
+        inline void matrix_inverse_affine_4x4_sse(const float* in, float* out)
+        {
+            const __m128 r0 = _mm_loadu_ps(in);
+            const __m128 r1 = _mm_loadu_ps(in + 4);
+            const __m128 r2 = _mm_loadu_ps(in + 8);
+
+            // Squared column lengths in lanes 0-2
+            __m128 len = _mm_mul_ps(r0, r0);
+            len = _mm_add_ps(len, _mm_mul_ps(r1, r1));
+            len = _mm_add_ps(len, _mm_mul_ps(r2, r2));
+            const __m128 rlen = _mm_div_ps(_mm_set1_ps(1), len);
+
+            // Columns of R', translation lane cleared
+            const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+            __m128 c0 = _mm_and_ps(_mm_mul_ps(r0, rlen), mask);
+            __m128 c1 = _mm_and_ps(_mm_mul_ps(r1, rlen), mask);
+            __m128 c2 = _mm_and_ps(_mm_mul_ps(r2, rlen), mask);
+
+            // Translation
+            const __m128 tx = _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 3, 3, 3));
+            const __m128 ty = _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 3, 3, 3));
+            const __m128 tz = _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 3, 3, 3));
+
+            // -R't, homogeneous 1 in lane 3
+            __m128 c3 = _mm_mul_ps(c0, tx);
+            c3 = _mm_add_ps(c3, _mm_mul_ps(c1, ty));
+            c3 = _mm_add_ps(c3, _mm_mul_ps(c2, tz));
+            c3 = _mm_sub_ps(_mm_setr_ps(0, 0, 0, 1), c3);
+
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+            _mm_storeu_ps(out, c0);
+            _mm_storeu_ps(out + 4, c1);
+            _mm_storeu_ps(out + 8, c2);
+            _mm_storeu_ps(out + 12, c3);
+        }
+    } // namespace detail
+
+    //! functor matrix_inverse
+    /*! SIMD 4x4 inverse
+     */
+    template <typename T, unsigned N>
+    struct matrix_inverse;
+
+    template <>
+    struct matrix_inverse<float, 4> {
+        //! out = inverse(in)
+        static inline void inverse(const float* in, float* out)
+        {
+            detail::matrix_inverse_4x4_sse(in, out);
+        }
+
+        //! out[i] = inverse(in[i])
+        static inline void inverse(const float* in,
+                                   float* out,
+                                   std::size_t count)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::matrix_inverse_4x4_array_fma(in, out, count);
+#else
+            if (cpu::has_avx2_fma())
+                detail::matrix_inverse_4x4_array_fma(in, out, count);
+            else
+                detail::matrix_inverse_4x4_array_sse(in, out, count);
+#endif
+        }
+
+        //! out = inverse(in) for rotation/scale/translation matrices
+        static inline void affine(const float* in, float* out)
+        {
+            detail::matrix_inverse_affine_4x4_sse(in, out);
+        }
+
+        //! out[i] = inverse(in[i]) for rotation/scale/translation matrices
+        static inline void affine(const float* in,
+                                  float* out,
+                                  std::size_t count)
+        {
+            for (std::size_t i = 0; i != count; ++i)
+                detail::matrix_inverse_affine_4x4_sse(in + i * 16,
+                                                      out + i * 16);
+        }
+    };
+} // namespace calc
+
+#endif
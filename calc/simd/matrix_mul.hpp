@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common.hpp"
+#include "cpu.hpp"
+#include "gemm.hpp"
 
 namespace calc {
 
@@ -27,6 +29,8 @@ namespace calc {
     template <typename, unsigned, unsigned, unsigned>
     struct matrix_mul;
 
+    /*! Runtime-sized matrix x vector: out(N0) = dat1(N0 x N1) * dat2(N1)
+     */
     template <>
     struct matrix_mul<float, 0, 0, 1> {
         static inline void mul(const float* dat1,
@@ -35,47 +39,13 @@ namespace calc {
                                const std::size_t N0,
                                const std::size_t N1)
         {
-            std::size_t registers0 = N1 / (16 / sizeof(float));
-            std::size_t registers1 = 16 / sizeof(float);
-
-            __m128* lhs = new __m128[N0 * registers0];
-            __m128* rhs = new __m128[N1 * registers1];
-
-            for (std::size_t i = 0; i != N1 * registers1; ++i) {
-                std::size_t ii = i * sizeof(float);
-                rhs[i] = detail::load(dat2 + ii);
-            }
-
-            for (std::size_t i = 0; i != N0 * registers0; ++i) {
-                std::size_t ii = i * sizeof(float);
-                lhs[i] = detail::load(dat1 + ii);
-            }
-
-            for (std::size_t i = 0; i != N0; ++i) {
-                std::size_t ii = i * registers0;
-                std::size_t j = 0;
-                for (; j != N1; ++j) {
-                    __m128 sum = {0, 0, 0, 0};
-
-                    std::size_t jj = j * registers1;
-                    std::size_t k = 0;
-                    for (; k != registers1; ++k) {
-                        __m128 tmp;
-                        tmp = _mm_mul_ps(lhs[ii + k], rhs[jj + k]);
-                        sum = _mm_add_ps(tmp, sum);
-                    }
-
-                    sum = _mm_hadd_ps(sum, sum);
-                    sum = _mm_hadd_ps(sum, sum);
-                    *out++ = sum[0];
-                }
-            }
-
-            delete[] lhs;
-            delete[] rhs;
+            detail::gemv(dat1, dat2, out, N0, N1);
         }
     };
 
+    /*! Runtime-sized product: out(N0 x M1) = dat1(N0 x N1) * dat2(N1 x M1);
+     *! cache-blocked and split across threads for large sizes
+     */
     template <>
     struct matrix_mul<float, 0, 0, 0> {
         static inline void mul(const float* dat1,
@@ -83,76 +53,10 @@ namespace calc {
                                float* out,
                                const std::size_t N0,
                                const std::size_t N1,
-                               const std::size_t M1)
+                               const std::size_t M1,
+                               const unsigned threads = 0)
         {
-            std::size_t registers0 = N1 / (16 / sizeof(float));
-            std::size_t registers1 = M1 / (16 / sizeof(float));
-
-            __m128* lhs = new __m128[N0 * registers0];
-            __m128* rhs = new __m128[N1 * registers1];
-            __m128* rhsfloat = new __m128[N1 * registers1];
-
-            // floatranspose
-            for (std::size_t i = 0; i != N1 * registers1; ++i) {
-                std::size_t ii = i * sizeof(float);
-                rhs[i] = detail::load(dat2 + ii);
-            }
-
-            for (std::size_t i = 0; i != N1; i += __stride__(sizeof(float))) {
-                std::size_t ii1 = i * registers1;
-                std::size_t ii2 = (i + 1) * registers1;
-                std::size_t ii3 = (i + 2) * registers1;
-                std::size_t ii4 = (i + 3) * registers1;
-
-                for (std::size_t j = 0; j != registers1; ++j) {
-                    std::size_t jj0 = ii1 + j;
-                    std::size_t jj1 = ii2 + j;
-                    std::size_t jj2 = ii3 + j;
-                    std::size_t jj3 = ii4 + j;
-
-                    __m128 y0 = _mm_unpacklo_ps(rhs[jj0], rhs[jj1]);
-                    __m128 y1 = _mm_unpackhi_ps(rhs[jj0], rhs[jj1]);
-                    __m128 y2 = _mm_unpacklo_ps(rhs[jj2], rhs[jj3]);
-                    __m128 y3 = _mm_unpackhi_ps(rhs[jj2], rhs[jj3]);
-
-                    rhsfloat[ii1] = _mm_movelh_ps(y0, y2);
-                    rhsfloat[ii2] = _mm_movehl_ps(y2, y0);
-                    rhsfloat[ii3] = _mm_movelh_ps(y1, y3);
-                    rhsfloat[ii4] = _mm_movehl_ps(y3, y1);
-                }
-            }
-
-            // Multiply
-            for (std::size_t i = 0; i != N0 * registers0; ++i) {
-                const std::size_t index = i * sizeof(float);
-
-                const float* dat = dat1 + index;
-                lhs[i] = _mm_load_ps(dat);
-            }
-
-            for (std::size_t i = 0; i != N0; ++i) {
-                std::size_t ii = i * registers0;
-                std::size_t j = 0;
-                for (; j != N1; ++j) {
-                    __m128 sum = {0, 0, 0, 0};
-
-                    std::size_t jj = j * registers1;
-                    std::size_t k = 0;
-                    for (; k != registers1; ++k) {
-                        __m128 tmp;
-                        tmp = _mm_mul_ps(lhs[ii + k], rhsfloat[jj + k]);
-                        sum = _mm_add_ps(tmp, sum);
-                    }
-
-                    sum = _mm_hadd_ps(sum, sum);
-                    sum = _mm_hadd_ps(sum, sum);
-                    *out++ = sum[0];
-                }
-            }
-
-            delete[] lhs;
-            delete[] rhs;
-            delete[] rhsfloat;
+            detail::gemm(dat1, dat2, out, N0, N1, M1, threads);
         }
     };
 
@@ -190,51 +94,225 @@ namespace calc {
         }
     };
 
+    namespace detail {
+
+        //! Scalar 4x4 product; reference path for CPUs without SIMD support
+        inline void matrix_mul_4x4_scalar(const float* dat1,
+                                          const float* dat2,
+                                          float* out)
+        {
+            float tmp[16];
+            for (unsigned r = 0; r != 4; ++r) {
+                for (unsigned c = 0; c != 4; ++c) {
+                    tmp[r * 4 + c] = dat1[r * 4 + 0] * dat2[0 * 4 + c]
+                                     + dat1[r * 4 + 1] * dat2[1 * 4 + c]
+                                     + dat1[r * 4 + 2] * dat2[2 * 4 + c]
+                                     + dat1[r * 4 + 3] * dat2[3 * 4 + c];
+                }
+            }
+
+            for (unsigned i = 0; i != 16; ++i)
+                out[i] = tmp[i];
+        }
+
+        //! SSE 4x4 product
+        /*! Each output row is the sum of the RHS rows scaled by the broadcast
+         *! LHS row elements, so no transpose or horizontal add is needed
+         */
+        inline void matrix_mul_4x4_sse(const float* dat1,
+                                       const float* dat2,
+                                       float* out)
+        {
+            // RHS rows are loaded up front so that out may alias dat2
+            const __m128 c0 = _mm_load_ps(dat2);
+            const __m128 c1 = _mm_load_ps(dat2 + 4);
+            const __m128 c2 = _mm_load_ps(dat2 + 8);
+            const __m128 c3 = _mm_load_ps(dat2 + 12);
+
+            for (unsigned i = 0; i != 16; i += 4) {
+                const __m128 r = _mm_load_ps(dat1 + i);
+
+                __m128 sum = _mm_mul_ps(_mm_shuffle_ps(r, r, 0x00), c0);
+                sum = _mm_add_ps(
+                    sum, _mm_mul_ps(_mm_shuffle_ps(r, r, 0x55), c1));
+                sum = _mm_add_ps(
+                    sum, _mm_mul_ps(_mm_shuffle_ps(r, r, 0xaa), c2));
+                sum = _mm_add_ps(
+                    sum, _mm_mul_ps(_mm_shuffle_ps(r, r, 0xff), c3));
+
+                _mm_store_ps(out + i, sum);
+            }
+        }
+
+        //! AVX2/FMA 4x4 product
+        /*! Same broadcast scheme as the SSE kernel, two LHS rows per 256-bit
+         *! register
+         */
+        __attribute__((target("avx2,fma"))) inline void matrix_mul_4x4_fma(
+            const float* dat1,
+            const float* dat2,
+            float* out)
+        {
+            const __m256 c0 = _mm256_broadcast_ps((const __m128*)(dat2));
+            const __m256 c1 = _mm256_broadcast_ps((const __m128*)(dat2 + 4));
+            const __m256 c2 = _mm256_broadcast_ps((const __m128*)(dat2 + 8));
+            const __m256 c3 = _mm256_broadcast_ps((const __m128*)(dat2 + 12));
+
+            const __m256 r01 = _mm256_loadu_ps(dat1);
+            const __m256 r23 = _mm256_loadu_ps(dat1 + 8);
+
+            __m256 out01 = _mm256_mul_ps(_mm256_shuffle_ps(r01, r01, 0x00), c0);
+            __m256 out23 = _mm256_mul_ps(_mm256_shuffle_ps(r23, r23, 0x00), c0);
+
+            out01 = _mm256_fmadd_ps(_mm256_shuffle_ps(r01, r01, 0x55), c1, out01);
+            out23 = _mm256_fmadd_ps(_mm256_shuffle_ps(r23, r23, 0x55), c1, out23);
+
+            out01 = _mm256_fmadd_ps(_mm256_shuffle_ps(r01, r01, 0xaa), c2, out01);
+            out23 = _mm256_fmadd_ps(_mm256_shuffle_ps(r23, r23, 0xaa), c2, out23);
+
+            out01 = _mm256_fmadd_ps(_mm256_shuffle_ps(r01, r01, 0xff), c3, out01);
+            out23 = _mm256_fmadd_ps(_mm256_shuffle_ps(r23, r23, 0xff), c3, out23);
+
+            _mm256_storeu_ps(out, out01);
+            _mm256_storeu_ps(out + 8, out23);
+        }
+
+        typedef void (*matrix_mul_4x4_fn)(const float*, const float*, float*);
+
+        //! @return
+        //!     Fastest 4x4 kernel supported by the host CPU
+        inline matrix_mul_4x4_fn select_matrix_mul_4x4()
+        {
+            return cpu::has_avx2_fma() ? &matrix_mul_4x4_fma
+                                       : &matrix_mul_4x4_sse;
+        }
+    } // namespace detail
+
+    /*! 4x4 product; the FMA kernel is called directly if the build targets it,
+     *! and is otherwise picked at runtime through CPUID
+     */
     template <>
     struct matrix_mul<float, 4, 4, 4> {
         static inline void mul(const float* dat1, const float* dat2, float* out)
         {
-            // detail::load & transpose RHS matrix
-            const __m128 x0 = detail::load(dat2);
-            const __m128 x1 = detail::load(dat2 + 4);
-            const __m128 x2 = detail::load(dat2 + 8);
-            const __m128 x3 = detail::load(dat2 + 12);
-
-            const __m128 y0 = _mm_unpacklo_ps(x0, x1);
-            const __m128 y1 = _mm_unpackhi_ps(x0, x1);
-            const __m128 y2 = _mm_unpacklo_ps(x2, x3);
-            const __m128 y3 = _mm_unpackhi_ps(x2, x3);
-
-            const __m128 c0 = _mm_movelh_ps(y0, y2);
-            const __m128 c1 = _mm_movehl_ps(y2, y0);
-            const __m128 c2 = _mm_movelh_ps(y1, y3);
-            const __m128 c3 = _mm_movehl_ps(y3, y1);
-
-            // detail::load LHS matrix
-            const __m128 r0 = detail::load(dat1);
-            const __m128 r1 = detail::load(dat1 + 4);
-            const __m128 r2 = detail::load(dat1 + 8);
-            const __m128 r3 = detail::load(dat1 + 12);
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::matrix_mul_4x4_fma(dat1, dat2, out);
+#else
+            static const detail::matrix_mul_4x4_fn kernel
+                = detail::select_matrix_mul_4x4();
+            kernel(dat1, dat2, out);
+#endif
+        }
+    };
 
-            detail::matrix_mul_impl<float>::mul(r0, c0, out);
-            detail::matrix_mul_impl<float>::mul(r0, c1, out + 1);
-            detail::matrix_mul_impl<float>::mul(r0, c2, out + 2);
-            detail::matrix_mul_impl<float>::mul(r0, c3, out + 3);
-
-            detail::matrix_mul_impl<float>::mul(r1, c0, out + 4);
-            detail::matrix_mul_impl<float>::mul(r1, c1, out + 5);
-            detail::matrix_mul_impl<float>::mul(r1, c2, out + 6);
-            detail::matrix_mul_impl<float>::mul(r1, c3, out + 7);
-
-            detail::matrix_mul_impl<float>::mul(r2, c0, out + 8);
-            detail::matrix_mul_impl<float>::mul(r2, c1, out + 9);
-            detail::matrix_mul_impl<float>::mul(r2, c2, out + 10);
-            detail::matrix_mul_impl<float>::mul(r2, c3, out + 11);
-
-            detail::matrix_mul_impl<float>::mul(r3, c0, out + 12);
-            detail::matrix_mul_impl<float>::mul(r3, c1, out + 13);
-            detail::matrix_mul_impl<float>::mul(r3, c2, out + 14);
-            detail::matrix_mul_impl<float>::mul(r3, c3, out + 15);
+    namespace detail {
+
+        //! SSE product of a chain of 4x4 matrices, times `scale`; the
+        //! running product stays in registers between factors
+        inline void matrix_chain_4x4_sse(const float* const* factors,
+                                         unsigned count,
+                                         float scale,
+                                         float* out)
+        {
+            __m128 r[4];
+            for (unsigned i = 0; i != 4; ++i)
+                r[i] = _mm_load_ps(factors[0] + i * 4);
+
+            for (unsigned f = 1; f != count; ++f) {
+                const float* dat = factors[f];
+                const __m128 c0 = _mm_load_ps(dat);
+                const __m128 c1 = _mm_load_ps(dat + 4);
+                const __m128 c2 = _mm_load_ps(dat + 8);
+                const __m128 c3 = _mm_load_ps(dat + 12);
+
+                for (unsigned i = 0; i != 4; ++i) {
+                    const __m128 x = r[i];
+
+                    // Summed pairwise to shorten the dependency chain
+                    const __m128 a = _mm_add_ps(
+                        _mm_mul_ps(_mm_shuffle_ps(x, x, 0x00), c0),
+                        _mm_mul_ps(_mm_shuffle_ps(x, x, 0x55), c1));
+                    const __m128 b = _mm_add_ps(
+                        _mm_mul_ps(_mm_shuffle_ps(x, x, 0xaa), c2),
+                        _mm_mul_ps(_mm_shuffle_ps(x, x, 0xff), c3));
+                    r[i] = _mm_add_ps(a, b);
+                }
+            }
+
+            if (scale != 1) {
+                const __m128 s = _mm_set1_ps(scale);
+                for (unsigned i = 0; i != 4; ++i)
+                    r[i] = _mm_mul_ps(r[i], s);
+            }
+
+            for (unsigned i = 0; i != 4; ++i)
+                _mm_store_ps(out + i * 4, r[i]);
+        }
+
+        //! AVX2/FMA product of a chain of 4x4 matrices, times `scale`
+        __attribute__((target("avx2,fma"))) inline void matrix_chain_4x4_fma(
+            const float* const* factors,
+            unsigned count,
+            float scale,
+            float* out)
+        {
+            __m256 r01 = _mm256_loadu_ps(factors[0]);
+            __m256 r23 = _mm256_loadu_ps(factors[0] + 8);
+
+            for (unsigned f = 1; f != count; ++f) {
+                const float* dat = factors[f];
+                const __m256 c0 = _mm256_broadcast_ps((const __m128*)(dat));
+                const __m256 c1 = _mm256_broadcast_ps((const __m128*)(dat + 4));
+                const __m256 c2 = _mm256_broadcast_ps((const __m128*)(dat + 8));
+                const __m256 c3 = _mm256_broadcast_ps((const __m128*)(dat + 12));
+
+                // Two independent partial sums per row pair, so each factor
+                // costs three dependent steps rather than four
+                __m256 a01 = _mm256_mul_ps(_mm256_shuffle_ps(r01, r01, 0x00), c0);
+                __m256 a23 = _mm256_mul_ps(_mm256_shuffle_ps(r23, r23, 0x00), c0);
+                __m256 b01 = _mm256_mul_ps(_mm256_shuffle_ps(r01, r01, 0xaa), c2);
+                __m256 b23 = _mm256_mul_ps(_mm256_shuffle_ps(r23, r23, 0xaa), c2);
+                a01 = _mm256_fmadd_ps(_mm256_shuffle_ps(r01, r01, 0x55), c1, a01);
+                a23 = _mm256_fmadd_ps(_mm256_shuffle_ps(r23, r23, 0x55), c1, a23);
+                b01 = _mm256_fmadd_ps(_mm256_shuffle_ps(r01, r01, 0xff), c3, b01);
+                b23 = _mm256_fmadd_ps(_mm256_shuffle_ps(r23, r23, 0xff), c3, b23);
+
+                r01 = _mm256_add_ps(a01, b01);
+                r23 = _mm256_add_ps(a23, b23);
+            }
+
+            if (scale != 1) {
+                const __m256 s = _mm256_set1_ps(scale);
+                r01 = _mm256_mul_ps(r01, s);
+                r23 = _mm256_mul_ps(r23, s);
+            }
+
+            _mm256_storeu_ps(out, r01);
+            _mm256_storeu_ps(out + 8, r23);
+        }
+    } // namespace detail
+
+    //! functor matrix_chain
+    /*! SIMD product of a chain of square matrices and a scalar
+     */
+    template <typename, unsigned>
+    struct matrix_chain;
+
+    template <>
+    struct matrix_chain<float, 4> {
+        static inline void mul(const float* const* factors,
+                               unsigned count,
+                               float scale,
+                               float* out)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::matrix_chain_4x4_fma(factors, count, scale, out);
+#else
+            if (cpu::has_avx2_fma())
+                detail::matrix_chain_4x4_fma(factors, count, scale, out);
+            else
+                detail::matrix_chain_4x4_sse(factors, count, scale, out);
+#endif
         }
     };
 
@@ -5,6 +5,8 @@
 
 #include <algorithm>
 
+#include "common.hpp"
+
 #include <immintrin.h>
 
 namespace calc {
@@ -50,14 +52,9 @@ namespace calc {
 
         static inline void sub(const T* dat1, const T* dat2, T* out, std::size_t size) {
 
-            size = std::max(size / sizeof(T), sizeof(T));
-
-            std::size_t i = 0;
-            for ( ; i < size; ++i)
-            {
-                std::size_t ii = i * 16 / sizeof(T);
+            detail::for_each_register<T>(size, [&](std::size_t ii) {
                 detail::matrix_sub_impl<T>::sub(dat1 + ii, dat2 + ii, out + ii);
-            }
+            });
         }
     };
 
@@ -96,12 +93,14 @@ namespace calc {
     template <typename T>
     struct matrix_sub<T, 9> {
 
-        static const unsigned i1 = 2;
+        static const unsigned i1 = 16 / sizeof(T);
+        static const unsigned i2 = 32 / sizeof(T);
 
         static inline void sub(const T* dat1, const T* dat2, T* out, std::size_t) {
-            // 2 passes
+            // 3 passes
             detail::matrix_sub_impl<T>::sub(dat1, dat2, out);
             detail::matrix_sub_impl<T>::sub(dat1 + i1, dat2 + i1, out + i1);
+            detail::matrix_sub_impl<T>::sub(dat1 + i2, dat2 + i2, out + i2);
         }
     };
 
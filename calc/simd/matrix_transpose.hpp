@@ -0,0 +1,100 @@
+#pragma once
+
+#ifndef _CALC_SIMD_MATRIX_TRANSPOSE_HPP
+#define _CALC_SIMD_MATRIX_TRANSPOSE_HPP
+
+#include "common.hpp"
+#include "cpu.hpp"
+
+namespace calc {
+
+    namespace detail {
+
+        //! 4x4 transpose; SSE
+        inline void matrix_transpose_4x4_sse(const float* in, float* out)
+        {
+            __m128 r0 = _mm_loadu_ps(in);
+            __m128 r1 = _mm_loadu_ps(in + 4);
+            __m128 r2 = _mm_loadu_ps(in + 8);
+            __m128 r3 = _mm_loadu_ps(in + 12);
+
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            _mm_storeu_ps(out, r0);
+            _mm_storeu_ps(out + 4, r1);
+            _mm_storeu_ps(out + 8, r2);
+            _mm_storeu_ps(out + 12, r3);
+        }
+
+        //! 4x4 transpose; AVX2, two rows per register
+        __attribute__((target("avx2"))) inline void matrix_transpose_4x4_avx2(
+            const float* in,
+            float* out)
+        {
+            const __m256 r01 = _mm256_loadu_ps(in);
+            const __m256 r23 = _mm256_loadu_ps(in + 8);
+
+            // (a0 c0 a1 c1 | b0 d0 b1 d1), (a2 c2 a3 c3 | b2 d2 b3 d3)
+            const __m256 lo = _mm256_unpacklo_ps(r01, r23);
+            const __m256 hi = _mm256_unpackhi_ps(r01, r23);
+
+            const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+            _mm256_storeu_ps(out, _mm256_permutevar8x32_ps(lo, order));
+            _mm256_storeu_ps(out + 8, _mm256_permutevar8x32_ps(hi, order));
+        }
+
+        typedef void (*matrix_transpose_4x4_fn)(const float*, float*);
+
+        //! @return
+        //!     Fastest 4x4 transpose supported by the host CPU
+        inline matrix_transpose_4x4_fn select_matrix_transpose_4x4()
+        {
+            return cpu::has_avx2_fma() ? &matrix_transpose_4x4_avx2
+                                       : &matrix_transpose_4x4_sse;
+        }
+    } // namespace detail
+
+    template <typename, unsigned>
+    struct matrix_transpose;
+
+    /*! In-register 4x4 transpose; also converts between row-major and
+     *! column-major storage
+     */
+    template <>
+    struct matrix_transpose<float, 4> {
+        static inline void transpose(const float* in, float* out)
+        {
+#if defined(__AVX2__)
+            detail::matrix_transpose_4x4_avx2(in, out);
+#else
+            static const detail::matrix_transpose_4x4_fn kernel
+                = detail::select_matrix_transpose_4x4();
+            kernel(in, out);
+#endif
+        }
+    };
+
+    /*! In-register 3x3 transpose over packed 9-float matrices. Reads and
+     *! writes one float past the end, which lands in Matrix padding
+     */
+    template <>
+    struct matrix_transpose<float, 3> {
+        static inline void transpose(const float* in, float* out)
+        {
+            // Rows start at 0, 3 and 6; lane 3 of each is discarded
+            __m128 r0 = _mm_loadu_ps(in);
+            __m128 r1 = _mm_loadu_ps(in + 3);
+            __m128 r2 = _mm_loadu_ps(in + 6);
+            __m128 r3 = _mm_setzero_ps();
+
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            // Each store's zero lane is overwritten by the next store
+            _mm_storeu_ps(out, r0);
+            _mm_storeu_ps(out + 3, r1);
+            _mm_storeu_ps(out + 6, r2);
+        }
+    };
+} // namespace calc
+
+#endif
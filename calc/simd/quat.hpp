@@ -0,0 +1,155 @@
+#pragma once
+
+#ifndef _CALC_SIMD_QUAT_HPP
+#define _CALC_SIMD_QUAT_HPP
+
+#include <cmath>
+
+#include "common.hpp"
+#include "sincos.hpp"
+
+namespace calc {
+
+    namespace detail {
+
+        //! Helper
+        //! @return Hamilton product p * q over (x, y, z, w) registers
+        inline __m128 quat_mul_sse(const __m128 p, const __m128 q)
+        {
+            // Per-term sign flips, lanes (x, y, z, w)
+            const __m128 signX = _mm_setr_ps(0.0F, -0.0F, 0.0F, -0.0F);
+            const __m128 signY = _mm_setr_ps(0.0F, 0.0F, -0.0F, -0.0F);
+            const __m128 signZ = _mm_setr_ps(-0.0F, 0.0F, 0.0F, -0.0F);
+
+            const __m128 px = _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m128 py = _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1));
+            const __m128 pz = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2));
+            const __m128 pw = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3));
+
+            // (qw, -qz, qy, -qx), (qz, qw, -qx, -qy), (-qy, qx, qw, -qz)
+            const __m128 qx = _mm_xor_ps(
+                _mm_shuffle_ps(q, q, _MM_SHUFFLE(0, 1, 2, 3)), signX);
+            const __m128 qy = _mm_xor_ps(
+                _mm_shuffle_ps(q, q, _MM_SHUFFLE(1, 0, 3, 2)), signY);
+            const __m128 qz = _mm_xor_ps(
+                _mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 3, 0, 1)), signZ);
+
+            __m128 out = _mm_mul_ps(pw, q);
+            out = _mm_add_ps(out, _mm_mul_ps(px, qx));
+            out = _mm_add_ps(out, _mm_mul_ps(py, qy));
+            out = _mm_add_ps(out, _mm_mul_ps(pz, qz));
+            return out;
+        }
+
+        //! Helper
+        //! @return 4-lane dot product, broadcast to every lane
+        inline __m128 quat_dot_sse(const __m128 a, const __m128 b)
+        {
+            __m128 d = _mm_mul_ps(a, b);
+            d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+            d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+            return d;
+        }
+
+        //! Helper
+        //! @return q / |q|
+        inline __m128 quat_normal_sse(const __m128 q)
+        {
+            return _mm_div_ps(q, _mm_sqrt_ps(quat_dot_sse(q, q)));
+        }
+
+        //! Helper
+        //! @return normal(a + (b - a) * t), with b negated when the two lie in
+        //!     opposite hemispheres so the shorter arc is taken
+        inline __m128 quat_nlerp_sse(const __m128 a, __m128 b, const float t)
+        {
+            const __m128 d = quat_dot_sse(a, b);
+            b = _mm_xor_ps(b, _mm_and_ps(d, _mm_set1_ps(-0.0F)));
+
+            const __m128 out = _mm_add_ps(
+                a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+            return quat_normal_sse(out);
+        }
+    } // namespace detail
+
+    //! functor quat_mul
+    /*! SIMD Hamilton product of two (x, y, z, w) quaternions
+     */
+    struct quat_mul {
+        static inline void mul(const float* p, const float* q, float* out)
+        {
+            _mm_store_ps(out,
+                         detail::quat_mul_sse(_mm_load_ps(p), _mm_load_ps(q)));
+        }
+    };
+
+    //! functor quat_normal
+    /*! SIMD quaternion normalization
+     */
+    struct quat_normal {
+        static inline void normal(const float* q, float* out)
+        {
+            _mm_store_ps(out, detail::quat_normal_sse(_mm_load_ps(q)));
+        }
+    };
+
+    //! functor quat_nlerp
+    /*! Normalized linear interpolation along the shorter arc
+     */
+    struct quat_nlerp {
+        static inline void nlerp(const float* a,
+                                 const float* b,
+                                 const float t,
+                                 float* out)
+        {
+            _mm_store_ps(
+                out,
+                detail::quat_nlerp_sse(_mm_load_ps(a), _mm_load_ps(b), t));
+        }
+    };
+
+    //! functor quat_slerp
+    /*! Spherical linear interpolation along the shorter arc; the three sines
+     *! come out of a single vectorized sincos
+     */
+    struct quat_slerp {
+        static inline void slerp(const float* a,
+                                 const float* b,
+                                 const float t,
+                                 float* out)
+        {
+            const __m128 va = _mm_load_ps(a);
+            __m128 vb = _mm_load_ps(b);
+
+            float d = _mm_cvtss_f32(detail::quat_dot_sse(va, vb));
+            if (d < 0) {
+                vb = _mm_xor_ps(vb, _mm_set1_ps(-0.0F));
+                d = -d;
+            }
+
+            // Nearly parallel; the weights below lose precision
+            if (d > 0.9995F) {
+                _mm_store_ps(out, detail::quat_nlerp_sse(va, vb, t));
+                return;
+            }
+
+            const float theta = std::acos(d);
+
+            __m128 s;
+            __m128 c;
+            detail::sincos_sse<sincos_accuracy::precise>(
+                _mm_setr_ps(theta, (1 - t) * theta, t * theta, 0), s, c);
+
+            const __m128 sinTheta
+                = _mm_shuffle_ps(s, s, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m128 wa = _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1));
+            const __m128 wb = _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 2, 2, 2));
+
+            const __m128 sum
+                = _mm_add_ps(_mm_mul_ps(va, wa), _mm_mul_ps(vb, wb));
+            _mm_store_ps(out, _mm_div_ps(sum, sinTheta));
+        }
+    };
+} // namespace calc
+
+#endif
@@ -48,14 +48,9 @@ namespace calc {
 
             const typename detail::__m<T>::T v2 = _mm_set1_ps(dat2);
 
-            size = std::max(size / sizeof(T), sizeof(T));
-
-            std::size_t i = 0;
-            for ( ; i < size; ++i)
-            {
-                std::size_t ii = i * 16 / sizeof(T);
+            detail::for_each_register<T>(size, [&](std::size_t ii) {
                 detail::scalar_mul_impl<T>::mul(dat1 + ii, v2, out + ii);
-            }
+            });
         }
     };
 
@@ -102,13 +97,15 @@ namespace calc {
 
         // Index offsets
         static const unsigned i1 = 16 / sizeof(float);
+        static const unsigned i2 = 32 / sizeof(float);
 
         static inline void mul(const float* dat1, const float dat2, float* out, std::size_t = 0) {
 
             const __m128 v2 = _mm_set1_ps(dat2);
-            // 2 passes
+            // 3 passes
             detail::scalar_mul_impl<float>::mul(dat1, v2, out);
             detail::scalar_mul_impl<float>::mul(dat1 + i1, v2, out + i1);
+            detail::scalar_mul_impl<float>::mul(dat1 + i2, v2, out + i2);
         }
     };
 
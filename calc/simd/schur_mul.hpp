@@ -46,12 +46,9 @@ namespace calc {
 
             static inline void mul(const T* dat1, const T* dat2, T* out, std::size_t size) {
 
-                std::size_t i = 0;
-                for ( ; i < size; i += sizeof(T))
-                {
-                    const std::size_t ii = i * 4;
+                for_each_register<T>(size, [&](std::size_t ii) {
                     schur_mul_impl<T>::mul(dat1 + ii, dat2 + ii, out + ii);
-                }
+                });
             }
         };
 #if 0
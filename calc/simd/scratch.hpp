@@ -0,0 +1,68 @@
+#pragma once
+
+#ifndef _CALC_SIMD_SCRATCH_HPP
+#define _CALC_SIMD_SCRATCH_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace calc {
+
+    namespace detail {
+
+        //! class scratch_arena
+        /*! Grow-only, cache-line aligned scratch memory for packing buffers;
+         *! one instance per thread so kernels never touch the allocator once
+         *! warmed up
+         */
+        class scratch_arena {
+        public:
+            static const std::size_t kAlignment = 64;
+
+            //! Dtor.
+            ~scratch_arena()
+            {
+                std::free(data_);
+            }
+
+            //! @return
+            //!     Arena owned by the calling thread
+            static scratch_arena& local()
+            {
+                thread_local scratch_arena arena;
+                return arena;
+            }
+
+            //! @return
+            //!     Buffer of at least `count` floats; contents are undefined
+            //!     and the pointer is only valid until the next call
+            float* acquire(std::size_t count)
+            {
+                if (count > capacity_) {
+                    std::size_t bytes = count * sizeof(float);
+                    bytes = (bytes + kAlignment - 1) / kAlignment * kAlignment;
+
+                    std::free(data_);
+                    data_ = static_cast<float*>(
+                        std::aligned_alloc(kAlignment, bytes));
+                    if (data_ == nullptr) {
+                        capacity_ = 0;
+                        throw std::bad_alloc();
+                    }
+
+                    capacity_ = bytes / sizeof(float);
+                }
+
+                return data_;
+            }
+        private:
+            // Arena memory
+            float* data_ = nullptr;
+            // Arena size in floats
+            std::size_t capacity_ = 0;
+        };
+    } // namespace detail
+} // namespace calc
+
+#endif
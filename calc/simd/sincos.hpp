@@ -0,0 +1,270 @@
+#pragma once
+
+#ifndef _CALC_SIMD_SINCOS_HPP
+#define _CALC_SIMD_SINCOS_HPP
+
+#include <cstddef>
+
+#include "common.hpp"
+#include "cpu.hpp"
+
+namespace calc {
+
+    //! Polynomial degree used by the vectorized sine/cosine
+    enum class sincos_accuracy {
+        // Degree 5/4 polynomials; absolute error below 4e-4
+        fast,
+        // Degree 7/8 polynomials; absolute error below 3e-7
+        precise
+    };
+
+    namespace detail {
+
+        // 4/pi
+        static const float kSincosFourOverPi = 1.27323954473516F;
+
+        // pi/4 split into three parts for an exact range reduction
+        static const float kSincosDP1 = 0.78515625F;
+        static const float kSincosDP2 = 2.4187564849853515625e-4F;
+        static const float kSincosDP3 = 3.77489497744594108e-8F;
+
+        //! Helper
+        //! Sine/cosine polynomial coefficients over [-pi/4, pi/4]
+        template <sincos_accuracy>
+        struct sincos_coeff;
+
+        template <>
+        struct sincos_coeff<sincos_accuracy::fast> {
+            static constexpr float s1 = -1.6666667e-1F;
+            static constexpr float s2 = 8.3333333e-3F;
+            static constexpr float s3 = 0;
+            static constexpr float c1 = 4.1666667e-2F;
+            static constexpr float c2 = 0;
+            static constexpr float c3 = 0;
+        };
+
+        template <>
+        struct sincos_coeff<sincos_accuracy::precise> {
+            static constexpr float s1 = -1.6666654611e-1F;
+            static constexpr float s2 = 8.3321608736e-3F;
+            static constexpr float s3 = -1.9515295891e-4F;
+            static constexpr float c1 = 4.166664568298827e-2F;
+            static constexpr float c2 = -1.388731625493765e-3F;
+            static constexpr float c3 = 2.443315711809948e-5F;
+        };
+
+        //! Sine and cosine of 4 lanes; SSE
+        /*! Reduces |x| to an octant of [-pi/4, pi/4], evaluates both
+         *! polynomials once and swaps/negates them per lane
+         */
+        template <sincos_accuracy A>
+        inline void sincos_sse(__m128 x, __m128& s, __m128& c)
+        {
+            typedef sincos_coeff<A> K;
+
+            const __m128 signMask = _mm_set1_ps(-0.0F);
+            __m128 signSin = _mm_and_ps(x, signMask);
+            x = _mm_andnot_ps(signMask, x);
+
+            // Octant, rounded up to even
+            __m128i j = _mm_cvttps_epi32(
+                _mm_mul_ps(x, _mm_set1_ps(kSincosFourOverPi)));
+            j = _mm_add_epi32(j, _mm_set1_epi32(1));
+            j = _mm_and_si128(j, _mm_set1_epi32(~1));
+            const __m128 y = _mm_cvtepi32_ps(j);
+
+            // Sign and polynomial selection per lane
+            const __m128i jc = _mm_sub_epi32(j, _mm_set1_epi32(2));
+            signSin = _mm_xor_ps(
+                signSin,
+                _mm_castsi128_ps(_mm_slli_epi32(
+                    _mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+            const __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(
+                _mm_andnot_si128(jc, _mm_set1_epi32(4)), 29));
+            const __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(
+                _mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+            // x - y * pi/4
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(kSincosDP1)));
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(kSincosDP2)));
+            x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(kSincosDP3)));
+            const __m128 z = _mm_mul_ps(x, x);
+
+            // Cosine polynomial
+            __m128 pc = _mm_set1_ps(K::c3);
+            pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(K::c2));
+            pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(K::c1));
+            pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+            pc = _mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5F)));
+            pc = _mm_add_ps(pc, _mm_set1_ps(1.0F));
+
+            // Sine polynomial
+            __m128 ps = _mm_set1_ps(K::s3);
+            ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(K::s2));
+            ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(K::s1));
+            ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+
+            const __m128 sinPoly = _mm_and_ps(polyMask, ps);
+            const __m128 cosPoly = _mm_andnot_ps(polyMask, pc);
+            s = _mm_xor_ps(_mm_or_ps(sinPoly, cosPoly), signSin);
+            c = _mm_xor_ps(_mm_add_ps(_mm_sub_ps(pc, cosPoly),
+                                      _mm_sub_ps(ps, sinPoly)),
+                           signCos);
+        }
+
+        //! Sine and cosine of 8 lanes; AVX2/FMA
+        template <sincos_accuracy A>
+        __attribute__((target("avx2,fma"))) inline void sincos_fma(
+            __m256 x, __m256& s, __m256& c)
+        {
+            typedef sincos_coeff<A> K;
+
+            const __m256 signMask = _mm256_set1_ps(-0.0F);
+            __m256 signSin = _mm256_and_ps(x, signMask);
+            x = _mm256_andnot_ps(signMask, x);
+
+            // Octant, rounded up to even
+            __m256i j = _mm256_cvttps_epi32(
+                _mm256_mul_ps(x, _mm256_set1_ps(kSincosFourOverPi)));
+            j = _mm256_add_epi32(j, _mm256_set1_epi32(1));
+            j = _mm256_and_si256(j, _mm256_set1_epi32(~1));
+            const __m256 y = _mm256_cvtepi32_ps(j);
+
+            // Sign and polynomial selection per lane
+            const __m256i jc = _mm256_sub_epi32(j, _mm256_set1_epi32(2));
+            signSin = _mm256_xor_ps(
+                signSin,
+                _mm256_castsi256_ps(_mm256_slli_epi32(
+                    _mm256_and_si256(j, _mm256_set1_epi32(4)), 29)));
+            const __m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(
+                _mm256_andnot_si256(jc, _mm256_set1_epi32(4)), 29));
+            const __m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+                _mm256_and_si256(j, _mm256_set1_epi32(2)),
+                _mm256_setzero_si256()));
+
+            // x - y * pi/4
+            x = _mm256_fnmadd_ps(y, _mm256_set1_ps(kSincosDP1), x);
+            x = _mm256_fnmadd_ps(y, _mm256_set1_ps(kSincosDP2), x);
+            x = _mm256_fnmadd_ps(y, _mm256_set1_ps(kSincosDP3), x);
+            const __m256 z = _mm256_mul_ps(x, x);
+
+            // Cosine polynomial
+            __m256 pc = _mm256_set1_ps(K::c3);
+            pc = _mm256_fmadd_ps(pc, z, _mm256_set1_ps(K::c2));
+            pc = _mm256_fmadd_ps(pc, z, _mm256_set1_ps(K::c1));
+            pc = _mm256_mul_ps(_mm256_mul_ps(pc, z), z);
+            pc = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5F), pc);
+            pc = _mm256_add_ps(pc, _mm256_set1_ps(1.0F));
+
+            // Sine polynomial
+            __m256 ps = _mm256_set1_ps(K::s3);
+            ps = _mm256_fmadd_ps(ps, z, _mm256_set1_ps(K::s2));
+            ps = _mm256_fmadd_ps(ps, z, _mm256_set1_ps(K::s1));
+            ps = _mm256_fmadd_ps(_mm256_mul_ps(ps, z), x, x);
+
+            const __m256 sinPoly = _mm256_and_ps(polyMask, ps);
+            const __m256 cosPoly = _mm256_andnot_ps(polyMask, pc);
+            s = _mm256_xor_ps(_mm256_or_ps(sinPoly, cosPoly), signSin);
+            c = _mm256_xor_ps(_mm256_add_ps(_mm256_sub_ps(pc, cosPoly),
+                                            _mm256_sub_ps(ps, sinPoly)),
+                              signCos);
+        }
+
+        //! Helper
+        //! Sine/cosine of a 0..3 element tail through a padded register
+        template <sincos_accuracy A>
+        inline void sincos_tail(const float* in,
+                                float* s,
+                                float* c,
+                                std::size_t count)
+        {
+            float buffer[4] __attribute__((aligned(16))) = {0, 0, 0, 0};
+            for (std::size_t i = 0; i != count; ++i)
+                buffer[i] = in[i];
+
+            __m128 vs;
+            __m128 vc;
+            sincos_sse<A>(_mm_load_ps(buffer), vs, vc);
+
+            float bs[4] __attribute__((aligned(16)));
+            float bc[4] __attribute__((aligned(16)));
+            _mm_store_ps(bs, vs);
+            _mm_store_ps(bc, vc);
+            for (std::size_t i = 0; i != count; ++i) {
+                s[i] = bs[i];
+                c[i] = bc[i];
+            }
+        }
+
+        //! Sine/cosine over arrays; SSE, 4 lanes
+        template <sincos_accuracy A>
+        inline void sincos_array_sse(const float* in,
+                                     float* s,
+                                     float* c,
+                                     std::size_t count)
+        {
+            const std::size_t body = count - count % 4;
+
+            for (std::size_t i = 0; i != body; i += 4) {
+                __m128 vs;
+                __m128 vc;
+                sincos_sse<A>(_mm_loadu_ps(in + i), vs, vc);
+                _mm_storeu_ps(s + i, vs);
+                _mm_storeu_ps(c + i, vc);
+            }
+
+            sincos_tail<A>(in + body, s + body, c + body, count - body);
+        }
+
+        //! Sine/cosine over arrays; AVX2/FMA, 8 lanes
+        template <sincos_accuracy A>
+        __attribute__((target("avx2,fma"))) inline void sincos_array_fma(
+            const float* in,
+            float* s,
+            float* c,
+            std::size_t count)
+        {
+            const std::size_t body = count - count % 8;
+
+            for (std::size_t i = 0; i != body; i += 8) {
+                __m256 vs;
+                __m256 vc;
+                sincos_fma<A>(_mm256_loadu_ps(in + i), vs, vc);
+                _mm256_storeu_ps(s + i, vs);
+                _mm256_storeu_ps(c + i, vc);
+            }
+
+            sincos_array_sse<A>(in + body, s + body, c + body, count - body);
+        }
+    } // namespace detail
+
+    //! functor simd_sincos
+    /*! Polynomial sine and cosine of every element of an array, in one pass
+     */
+    template <sincos_accuracy A = sincos_accuracy::precise>
+    struct simd_sincos {
+        //! s[i] = sin(in[i]), c[i] = cos(in[i])
+        static inline void sincos(const float* in,
+                                  float* s,
+                                  float* c,
+                                  std::size_t count)
+        {
+#if defined(__AVX2__) && defined(__FMA__)
+            detail::sincos_array_fma<A>(in, s, c, count);
+#else
+            if (cpu::has_avx2_fma())
+                detail::sincos_array_fma<A>(in, s, c, count);
+            else
+                detail::sincos_array_sse<A>(in, s, c, count);
+#endif
+        }
+
+        //! Sine and cosine of up to 4 angles held in one register
+        static inline void sincos(__m128 in, __m128& s, __m128& c)
+        {
+            detail::sincos_sse<A>(in, s, c);
+        }
+    };
+} // namespace calc
+
+#endif
@@ -24,9 +24,9 @@ Camera::Camera(const calc::vec3f& eye,
 void Camera::move(const calc::vec3f& direction)
 {
     const calc::mat3f rot
-        = calc::rotate_3x(calc::radians(viewerOrientation_.pitch))
-          * calc::rotate_3y(calc::radians(viewerOrientation_.yaw))
-          * calc::rotate_3z(calc::radians(viewerOrientation_.roll));
+        = calc::rotate_euler_3(calc::radians(viewerOrientation_.pitch),
+                               calc::radians(viewerOrientation_.yaw),
+                               calc::radians(viewerOrientation_.roll));
 
     E_.value -= rot * direction;
 }
@@ -34,9 +34,9 @@ void Camera::move(const calc::vec3f& direction)
 void Camera::set_position(const calc::vec3f& direction)
 {
     const calc::mat3f rot
-        = calc::rotate_3x(calc::radians(viewerOrientation_.pitch))
-          * calc::rotate_3y(calc::radians(viewerOrientation_.yaw))
-          * calc::rotate_3z(calc::radians(viewerOrientation_.roll));
+        = calc::rotate_euler_3(calc::radians(viewerOrientation_.pitch),
+                               calc::radians(viewerOrientation_.yaw),
+                               calc::radians(viewerOrientation_.roll));
 
     E_.value = rot * direction;
 }
@@ -72,10 +72,11 @@ void Camera::rotate_viewer(const float pitch, const float yaw, const float roll)
     viewerOrientation_.yaw += yaw;
     viewerOrientation_.roll += roll;
 
-    const calc::mat3f rot
-        = calc::rotate_3z(calc::radians(viewerOrientation_.roll))
-          * calc::rotate_3y(calc::radians(viewerOrientation_.yaw))
-          * calc::rotate_3x(calc::radians(viewerOrientation_.pitch));
+    // Rz * Ry * Rx, i.e. the transpose of Rx * Ry * Rz over negated angles
+    const calc::mat3f rot = calc::transpose(
+        calc::rotate_euler_3(calc::radians(-viewerOrientation_.pitch),
+                             calc::radians(-viewerOrientation_.yaw),
+                             calc::radians(-viewerOrientation_.roll)));
 
     U_.value = rot * U_.defaultValue;
     F_.value = rot * F_.defaultValue;
@@ -108,11 +109,12 @@ void Camera::calc_look_at()
     lookAt(1, 3) = -calc::dot(u, E_.value);
     lookAt(2, 3) = calc::dot(f, E_.value);
 
-    lookAt_.value = lookAt
-                    * calc::rotate_4x(calc::radians(viewOrientation_.pitch))
-                    * calc::rotate_4y(calc::radians(viewOrientation_.yaw))
-                    * calc::rotate_4z(calc::radians(viewOrientation_.roll));
-    lookAt_.deviceValue = calc::transpose(lookAt_.value);
+    lookAt_.value
+        = lookAt
+          * calc::rotate_euler_4(calc::radians(viewOrientation_.pitch),
+                                 calc::radians(viewOrientation_.yaw),
+                                 calc::radians(viewOrientation_.roll));
+    lookAt_.deviceValue = calc::mat4f_cm(lookAt_.value);
 }
 
 void Camera::calc_projection()
@@ -130,107 +132,11 @@ void Camera::calc_projection()
     projection_.value(3, 2) = -1.0;
     projection_.value(3, 3) = 0.0;
 
-    projection_.deviceValue = calc::transpose(projection_.value);
+    projection_.deviceValue = calc::mat4f_cm(projection_.value);
 }
 
 namespace {
 
-    /*! @brief Helper, generates hadamard product
-     */
-    inline calc::vec4f operator*(const calc::vec4f& v1, const calc::vec4f& v2)
-    {
-        float a = v1[0] * v2[0];
-        float b = v1[1] * v2[1];
-        float c = v1[2] * v2[2];
-        float d = v1[3] * v2[3];
-
-        return calc::vec4f(a, b, c, d);
-    }
-
-    /*! @brief Helper, returns inverse of input matrix
-     */
-    calc::mat4f inverse(const calc::mat4f& m)
-    {
-        float coef00 = (m(2, 2) * m(3, 3)) - (m(2, 3) * m(3, 2));
-        float coef02 = (m(2, 1) * m(3, 3)) - (m(2, 3) * m(3, 1));
-        float coef03 = (m(2, 1) * m(3, 2)) - (m(2, 2) * m(3, 1));
-
-        float coef04 = (m(1, 2) * m(3, 3)) - (m(1, 3) * m(3, 2));
-        float coef06 = (m(1, 1) * m(3, 3)) - (m(1, 3) * m(3, 1));
-        float coef07 = (m(1, 1) * m(3, 2)) - (m(1, 2) * m(3, 1));
-
-        float coef08 = (m(1, 2) * m(2, 3)) - (m(1, 3) * m(2, 2));
-        float coef10 = (m(1, 1) * m(2, 3)) - (m(1, 3) * m(2, 1));
-        float coef11 = (m(1, 1) * m(2, 2)) - (m(1, 2) * m(2, 1));
-
-        float coef12 = (m(0, 2) * m(3, 3)) - (m(0, 3) * m(3, 2));
-        float coef14 = (m(0, 1) * m(3, 3)) - (m(0, 3) * m(3, 1));
-        float coef15 = (m(0, 1) * m(3, 2)) - (m(0, 2) * m(3, 1));
-
-        float coef16 = (m(0, 2) * m(2, 3)) - (m(0, 3) * m(2, 2));
-        float coef18 = (m(0, 1) * m(2, 3)) - (m(0, 3) * m(2, 1));
-        float coef19 = (m(0, 1) * m(2, 2)) - (m(0, 2) * m(2, 1));
-
-        float coef20 = (m(0, 2) * m(1, 3)) - (m(0, 3) * m(1, 2));
-        float coef22 = (m(0, 1) * m(1, 3)) - (m(0, 3) * m(1, 1));
-        float coef23 = (m(0, 1) * m(1, 2)) - (m(0, 2) * m(1, 1));
-
-        calc::vec4f fac0(coef00, coef00, coef02, coef03);
-        calc::vec4f fac1(coef04, coef04, coef06, coef07);
-        calc::vec4f fac2(coef08, coef08, coef10, coef11);
-        calc::vec4f fac3(coef12, coef12, coef14, coef15);
-        calc::vec4f fac4(coef16, coef16, coef18, coef19);
-        calc::vec4f fac5(coef20, coef20, coef22, coef23);
-
-        calc::vec4f vec0(m(0, 1), m(0, 0), m(0, 0), m(0, 0));
-        calc::vec4f vec1(m(1, 1), m(1, 0), m(1, 0), m(1, 0));
-        calc::vec4f vec2(m(2, 1), m(2, 0), m(2, 0), m(2, 0));
-        calc::vec4f vec3(m(3, 1), m(3, 0), m(3, 0), m(3, 0));
-
-        calc::vec4f inv0(vec1 * fac0 - vec2 * fac1 + vec3 * fac2);
-        calc::vec4f inv1(vec0 * fac0 - vec2 * fac3 + vec3 * fac4);
-        calc::vec4f inv2(vec0 * fac1 - vec1 * fac3 + vec3 * fac5);
-        calc::vec4f inv3(vec0 * fac2 - vec1 * fac4 + vec2 * fac5);
-
-        calc::vec4f signA(+1, -1, +1, -1);
-        calc::vec4f signB(-1, +1, -1, +1);
-
-        const calc::vec4f is0 = inv0 * signA;
-        const calc::vec4f is1 = inv1 * signB;
-        const calc::vec4f is2 = inv2 * signA;
-        const calc::vec4f is3 = inv3 * signB;
-
-        const calc::mat4f inverseMat(is0[0],
-                                     is1[0],
-                                     is2[0],
-                                     is3[0],
-                                     is0[1],
-                                     is1[1],
-                                     is2[1],
-                                     is3[1],
-                                     is0[2],
-                                     is1[2],
-                                     is2[2],
-                                     is3[2],
-                                     is0[3],
-                                     is1[3],
-                                     is2[3],
-                                     is3[3]);
-
-        const calc::vec4f row0(inverseMat(0, 0),
-                               inverseMat(0, 1),
-                               inverseMat(0, 2),
-                               inverseMat(0, 3));
-
-        const calc::vec4f dot0(calc::vec4f(m(0, 0), m(0, 1), m(0, 2), m(0, 3))
-                               * row0);
-
-        float dot1 = (dot0[0] + dot0[1]) + (dot0[2] + dot0[3]);
-        float oneOverDeterminant = 1.0 / dot1;
-
-        return inverseMat * oneOverDeterminant;
-    }
-
     // Helper
     ray unproject_impl(float x,
                        float y,
@@ -243,7 +149,7 @@ namespace {
         x = 2 * x / screenWidth - 1;
         y = 2 * y / screenHeight - 1;
 
-        const calc::mat4f inv = inverse(scene);
+        const calc::mat4f inv = calc::inverse(scene);
 
         ray r;
         r.x = x;
@@ -284,7 +190,7 @@ void Camera::update()
     calc_projection();
 
     scene_.value = projection_.value * lookAt_.value;
-    scene_.deviceValue = calc::transpose(scene_.value);
+    scene_.deviceValue = calc::mat4f_cm(scene_.value);
 }
 
 float Camera::get_screen_width() const
@@ -307,9 +213,9 @@ const calc::mat4f& Camera::get_scene() const
     return scene_.value;
 }
 
-const calc::mat4f& Camera::get_device_scene() const
+const calc::mat4f_cm& Camera::get_device_scene() const
 {
-    return scene_.value;
+    return scene_.deviceValue;
 }
 
 const calc::mat4f& Camera::get_look_at() const
@@ -317,7 +223,7 @@ const calc::mat4f& Camera::get_look_at() const
     return lookAt_.value;
 }
 
-const calc::mat4f& Camera::get_device_look_at() const
+const calc::mat4f_cm& Camera::get_device_look_at() const
 {
     return lookAt_.deviceValue;
 }
@@ -327,7 +233,7 @@ const calc::mat4f& Camera::get_projection() const
     return projection_.value;
 }
 
-const calc::mat4f& Camera::get_device_projection() const
+const calc::mat4f_cm& Camera::get_device_projection() const
 {
     return projection_.deviceValue;
 }
@@ -85,16 +85,17 @@ public:
 
     const calc::mat4f& get_scene()
         const; //!> @return The projection x view matrix.
-    const calc::mat4f& get_device_scene()
+    const calc::mat4f_cm& get_device_scene()
         const; //!> @return The projection x view matrix in column-major
                //! ordering.
 
     const calc::mat4f& get_look_at() const; //!> @return The view matrix.
-    const calc::mat4f& get_device_look_at() const; //!> @return The view matrix.
+    const calc::mat4f_cm& get_device_look_at()
+        const; //!> @return The view matrix.
 
     const calc::mat4f& get_projection()
         const; //!> @return The projection matrix.
-    const calc::mat4f& get_device_projection()
+    const calc::mat4f_cm& get_device_projection()
         const; //!> @return The projection matrix.
 private:
     void calc_look_at(); //> Helper.
@@ -144,10 +145,11 @@ private:
     vector_pair U_; //> Up direction vector.
 
     //! struct matrix_pair
-    /*! Matrix and its (transposed) GPU device-friendly pair.
+    /*! Matrix and its column-major GPU device-friendly pair.
      */
     struct matrix_pair {
-        calc::mat4f value, deviceValue;
+        calc::mat4f value;
+        calc::mat4f_cm deviceValue;
     };
 
     matrix_pair lookAt_; //> View matrix.
@@ -0,0 +1,38 @@
+#include "camera_block.hpp"
+#include "gl_state.hpp"
+#include "glad/glad.h"
+#include <algorithm>
+
+void render::init(camera_block& refblock)
+{
+    refblock = camera_block();
+
+    glGenBuffers(1, &refblock.buffer);
+    state::bind_buffer_base(
+        GL_UNIFORM_BUFFER, camera_block::kBinding, refblock.buffer);
+    glBufferData(
+        GL_UNIFORM_BUFFER, sizeof(refblock.data), nullptr, GL_DYNAMIC_DRAW);
+}
+
+void render::update(camera_block& refblock,
+                    const calc::mat4f_cm& view,
+                    const calc::mat4f_cm& projection)
+{
+    float* data = refblock.data;
+
+    // The product only changes with its factors
+    if (refblock.valid
+        && std::equal(calc::data(view), calc::data(view) + 16, data)
+        && std::equal(
+            calc::data(projection), calc::data(projection) + 16, data + 16))
+        return;
+
+    const calc::mat4f_cm viewProjection = projection * view;
+    std::copy_n(calc::data(view), 16, data);
+    std::copy_n(calc::data(projection), 16, data + 16);
+    std::copy_n(calc::data(viewProjection), 16, data + 32);
+    refblock.valid = true;
+
+    state::bind_buffer(GL_UNIFORM_BUFFER, refblock.buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(refblock.data), data);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "calc/matrix.hpp"
+
+namespace render {
+
+    //! struct camera_block
+    /*! Per-frame camera uniforms in one std140 uniform buffer, bound at a
+     *! fixed binding point and shared by every program that declares the
+     *! block
+     */
+    struct camera_block {
+        // Uniform buffer binding point
+        static constexpr unsigned kBinding = 0;
+        // Block name in the shaders
+        static constexpr const char* kName = "Camera";
+
+        // Uniform buffer
+        unsigned buffer;
+        // Last upload, std140: view, projection, projection * view
+        float data[48];
+        // Whether data holds the last upload
+        bool valid;
+    };
+
+    /*! @brief Implementation.
+     *! Allocates the buffer and binds it at camera_block::kBinding
+     */
+    void init(camera_block& refblock);
+
+    /*! @brief Implementation.
+     *! Uploads the camera matrices and their product unless unchanged since
+     *! the last call
+     */
+    void update(camera_block& refblock,
+                const calc::mat4f_cm& view,
+                const calc::mat4f_cm& projection);
+} // namespace render
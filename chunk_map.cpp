@@ -0,0 +1,400 @@
+#include "chunk_map.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+
+    // Half size of the unit box and squares, around their center
+    constexpr float kUnitExtent = 0.5F;
+
+    // Chunk buffers per worker; bounds the chunks being generated or
+    // awaiting upload
+    constexpr unsigned kBuffersPerWorker = 2;
+
+    // Most worker threads; one core is left to the render thread
+    constexpr unsigned kMaxWorkers = 8;
+
+    // Chunks uploaded per update(); keeps each frame's GL work short
+    constexpr unsigned kUploadsPerFrame = 2;
+
+    // Rows of tiles between the cage edge and the fresh grass
+    constexpr int kWallThickness = 2;
+
+    // Wall segment scale, also their spacing
+    constexpr int kWallSegment = 3;
+
+    // Helper
+    // @return floor(a / b) for b > 0
+    int floor_div(int a, int b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    // Helper
+    // Appends a column-major translation with uniform xy scale
+    void append(std::vector<float>& out, float x, float y, float z, float s)
+    {
+        const float mat[16] = {
+            s, 0, 0, 0, 0, s, 0, 0, 0, 0, 1, 0, x, y, z, 1,
+        };
+        out.insert(out.end(), mat, mat + 16);
+    }
+
+    // Helper
+    // Appends the segments of one straight wall whose centers fall in
+    // [lo, hi); segments sit at kWallSegment * i along the wall for i in
+    // (-half, half), across it at `across`
+    void append_wall(std::vector<float>& out,
+                     int half,
+                     int across,
+                     bool vertical,
+                     int lo,
+                     int hi)
+    {
+        const int first = std::max(1 - half, -floor_div(-lo, kWallSegment));
+        const int last = std::min(half - 1, floor_div(hi - 1, kWallSegment));
+
+        int i = first;
+        for (; i <= last; ++i) {
+            const float along = float(i * kWallSegment);
+            append(out,
+                   vertical ? float(across) : along,
+                   vertical ? along : float(across),
+                   -1.0F,
+                   float(kWallSegment));
+        }
+    }
+} // namespace
+
+ChunkMap::ChunkMap(const map_layout& layout,
+                   const unsigned* wallTAO,
+                   unsigned dryGrassTAO,
+                   unsigned grassTAO)
+    : layout_(layout)
+    , slots_((2 * layout.viewRadius + 1) * (2 * layout.viewRadius + 1))
+{
+    const unsigned dryGrassTileTAO[] = {dryGrassTAO, dryGrassTAO};
+    const unsigned grassTileTAO[] = {grassTAO, grassTAO};
+    const unsigned tiles = layout_.chunkSize * layout_.chunkSize;
+
+    for (slot& s : slots_) {
+        s.used = false;
+        s.grass = render::StaticMesh(
+            grassTileTAO, 2, render::instance_format::translate_scale);
+        s.dryGrass = render::StaticMesh(
+            dryGrassTileTAO, 2, render::instance_format::translate_scale);
+        s.grid = render::GridSquare(tiles,
+                                    render::instance_format::translate_scale);
+        s.wall = render::Box(wallTAO,
+                             2,
+                             layout_.chunkSize,
+                             render::instance_format::affine);
+    }
+
+    const unsigned workers = std::min(
+        std::max(std::thread::hardware_concurrency(), 2U) - 1, kMaxWorkers);
+
+    // Reserve each buffer for a full chunk up front, so generating never
+    // reallocates; a chunk has at most one wall segment per kWallSegment
+    // tiles along each of its four sides
+    const unsigned segments = 4 * (layout_.chunkSize / kWallSegment + 1);
+    buffers_.resize(workers * kBuffersPerWorker);
+    for (chunk_data& refdata : buffers_) {
+        refdata.grass.reserve(16 * tiles);
+        refdata.dryGrass.reserve(16 * tiles);
+        refdata.grid.reserve(16 * tiles);
+        refdata.wall.reserve(16 * segments);
+        free_.push_back(&refdata);
+    }
+
+    unsigned i = 0;
+    for (; i != workers; ++i)
+        workers_.emplace_back(&ChunkMap::work, this);
+}
+
+ChunkMap::~ChunkMap()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& refworker : workers_)
+        refworker.join();
+}
+
+void ChunkMap::update(float x, float y)
+{
+    focus(x, y);
+    receive(kUploadsPerFrame);
+    request();
+}
+
+unsigned ChunkMap::load(float x, float y)
+{
+    focus(x, y);
+    request();
+
+    unsigned uploads = 0;
+    while (!inFlight_.empty()) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] { return !done_.empty(); });
+        }
+        uploads += receive(unsigned(buffers_.size()));
+        request();
+    }
+    return uploads;
+}
+
+void ChunkMap::submit(render::queue& refqueue,
+                      const calc::frustum& reffrustum,
+                      const calc::mat4f_cm& lookAt,
+                      Program& tileProgram,
+                      Program& wallProgram,
+                      Program* gridProgram)
+{
+    for (slot& s : slots_) {
+        if (!s.used || !render::visible(s.bounds, reffrustum))
+            continue;
+
+        // View distance of the chunk center
+        const float x = (s.bounds.min[0] + s.bounds.max[0]) / 2;
+        const float y = (s.bounds.min[1] + s.bounds.max[1]) / 2;
+        const float depth
+            = -(lookAt(2, 0) * x + lookAt(2, 1) * y + lookAt(2, 3));
+
+        if (s.grass.instance_count() != 0)
+            render::submit(refqueue, s.grass, tileProgram, depth);
+        if (s.dryGrass.instance_count() != 0)
+            render::submit(refqueue, s.dryGrass, tileProgram, depth);
+
+        if (gridProgram != nullptr
+            && render::cull(s.gridCull, s.grid, reffrustum) != 0)
+            render::submit(refqueue, s.grid, *gridProgram, depth);
+
+        if (render::cull(s.wallCull, s.wall, reffrustum) != 0)
+            render::submit(refqueue, s.wall, wallProgram, depth);
+    }
+}
+
+const map_layout& ChunkMap::layout() const
+{
+    return layout_;
+}
+
+void ChunkMap::focus(float x, float y)
+{
+    focusX_ = floor_div(int(std::floor(x)), layout_.chunkSize);
+    focusY_ = floor_div(int(std::floor(y)), layout_.chunkSize);
+}
+
+unsigned ChunkMap::receive(unsigned limit)
+{
+    // Upload finished chunks still in range
+    unsigned uploads = 0;
+    while (uploads != limit) {
+        chunk_data* data = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (done_.empty())
+                break;
+
+            data = done_.front();
+            done_.erase(done_.begin());
+        }
+
+        inFlight_.erase(std::find(inFlight_.begin(),
+                                  inFlight_.end(),
+                                  std::make_pair(data->x, data->y)));
+
+        if (in_range(data->x, data->y)) {
+            upload(*data);
+            ++uploads;
+        }
+        free_.push_back(data);
+    }
+    return uploads;
+}
+
+void ChunkMap::request()
+{
+    // Request missing chunks, nearest ring first
+    const int halfWidth = layout_.fieldWidth / 2;
+    const int halfLength = layout_.fieldLength / 2;
+    const int size = layout_.chunkSize;
+
+    int ring = 0;
+    for (; ring <= layout_.viewRadius && !free_.empty(); ++ring) {
+        int j = focusY_ - ring;
+        for (; j <= focusY_ + ring && !free_.empty(); ++j) {
+            int i = focusX_ - ring;
+            for (; i <= focusX_ + ring && !free_.empty(); ++i) {
+                // Inner rings are done
+                if (std::abs(i - focusX_) != ring
+                    && std::abs(j - focusY_) != ring)
+                    continue;
+
+                // Outside the field
+                if (i * size > halfWidth || (i + 1) * size <= -halfWidth
+                    || j * size > halfLength || (j + 1) * size <= -halfLength)
+                    continue;
+
+                const std::pair<int, int> chunk(i, j);
+                if (std::find(inFlight_.begin(), inFlight_.end(), chunk)
+                    != inFlight_.end())
+                    continue;
+
+                const auto resident = std::find_if(
+                    slots_.begin(), slots_.end(), [&](const slot& s) {
+                        return s.used && s.x == i && s.y == j;
+                    });
+                if (resident != slots_.end())
+                    continue;
+
+                chunk_data* data = free_.back();
+                free_.pop_back();
+                data->x = i;
+                data->y = j;
+                inFlight_.push_back(chunk);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    requests_.push_back(data);
+                }
+                wake_.notify_one();
+            }
+        }
+    }
+}
+
+void ChunkMap::work()
+{
+    for (;;) {
+        chunk_data* data = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !requests_.empty(); });
+            if (stop_)
+                return;
+
+            // Requests come nearest first
+            data = requests_.front();
+            requests_.erase(requests_.begin());
+        }
+
+        generate(*data);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.push_back(data);
+        }
+        ready_.notify_one();
+    }
+}
+
+void ChunkMap::generate(chunk_data& refdata) const
+{
+    refdata.grass.clear();
+    refdata.dryGrass.clear();
+    refdata.grid.clear();
+    refdata.wall.clear();
+
+    const int size = layout_.chunkSize;
+    const int x0 = refdata.x * size;
+    const int y0 = refdata.y * size;
+
+    const int fieldX = layout_.fieldWidth / 2;
+    const int fieldY = layout_.fieldLength / 2;
+    const int cageX = layout_.cageWidth / 2;
+    const int cageY = layout_.cageLength / 2;
+
+    // Tiles centered on [x0, x0 + size) x [y0, y0 + size), the grid half a
+    // tile off
+    int j = std::max(y0, -fieldY);
+    for (; j < std::min(y0 + size, fieldY + 1); ++j) {
+        int i = std::max(x0, -fieldX);
+        for (; i < std::min(x0 + size, fieldX + 1); ++i) {
+            const bool cage = std::abs(i) <= cageX - kWallThickness
+                              && std::abs(j) <= cageY - kWallThickness;
+            append(cage ? refdata.grass : refdata.dryGrass, i, j, 0, 1);
+
+            if (i < fieldX && j < fieldY)
+                append(refdata.grid, i + 0.5F, j + 0.5F, 0, 1);
+        }
+    }
+
+    // Wall segments centered in the chunk
+    const int halfX = cageX / kWallSegment;
+    const int halfY = cageY / kWallSegment;
+    const auto inside = [&](int v, int lo) { return v >= lo && v < lo + size; };
+
+    // West and east walls
+    if (inside(cageX - 1, x0))
+        append_wall(refdata.wall, halfY, cageX - 1, true, y0, y0 + size);
+    if (inside(1 - cageX, x0))
+        append_wall(refdata.wall, halfY, 1 - cageX, true, y0, y0 + size);
+
+    // North and south walls
+    if (inside(cageY - 1, y0))
+        append_wall(refdata.wall, halfX, cageY - 1, false, x0, x0 + size);
+    if (inside(1 - cageY, y0))
+        append_wall(refdata.wall, halfX, 1 - cageY, false, x0, x0 + size);
+
+    render::init(refdata.gridCull,
+                 refdata.grid.data(),
+                 refdata.grid.size() / 16,
+                 kUnitExtent);
+    render::init(refdata.wallCull,
+                 refdata.wall.data(),
+                 refdata.wall.size() / 16,
+                 kUnitExtent);
+}
+
+void ChunkMap::upload(chunk_data& refdata)
+{
+    auto target = std::find_if(slots_.begin(), slots_.end(), [](slot& s) {
+        return !s.used;
+    });
+    if (target == slots_.end()) {
+        target = std::find_if(slots_.begin(), slots_.end(), [&](slot& s) {
+            return !in_range(s.x, s.y);
+        });
+    }
+    // The pool holds every chunk in range
+    /*ASSERT*/ assert(target != slots_.end());
+
+    slot& s = *target;
+    s.x = refdata.x;
+    s.y = refdata.y;
+    s.used = true;
+
+    s.grass.reset(refdata.grass.data(), refdata.grass.size() / 16);
+    s.dryGrass.reset(refdata.dryGrass.data(), refdata.dryGrass.size() / 16);
+    s.grid.reset(refdata.grid.data(), refdata.grid.size() / 16);
+    s.wall.reset(refdata.wall.data(), refdata.wall.size() / 16);
+
+    // The slot's old bounds go back to the pool with the buffer
+    std::swap(s.gridCull, refdata.gridCull);
+    std::swap(s.wallCull, refdata.wallCull);
+
+    // Wall segments reach past the chunk edge; ground at z = 0, walls
+    // down to z = -1.5
+    const float size = float(layout_.chunkSize);
+    const float margin = kWallSegment * kUnitExtent + kUnitExtent;
+    s.bounds.min[0] = refdata.x * size - margin;
+    s.bounds.min[1] = refdata.y * size - margin;
+    s.bounds.min[2] = -1.5F;
+    s.bounds.max[0] = (refdata.x + 1) * size + margin;
+    s.bounds.max[1] = (refdata.y + 1) * size + margin;
+    s.bounds.max[2] = kUnitExtent;
+}
+
+bool ChunkMap::in_range(int x, int y) const
+{
+    return std::abs(x - focusX_) <= layout_.viewRadius
+           && std::abs(y - focusY_) <= layout_.viewRadius;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "box.hpp"
+#include "calc/matrix.hpp"
+#include "cull.hpp"
+#include "grid_square.hpp"
+#include "program.hpp"
+#include "render_queue.hpp"
+#include "static_mesh.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! struct map_layout
+/*! Arena dimensions, in unit tiles centered on the origin. The cage is
+ *! walled and floored with fresh grass; the rest of the field is dry grass
+ *! under the grid.
+ */
+struct map_layout {
+    // Cage size; even
+    int cageWidth = 30;
+    int cageLength = 30;
+    // Field size, cage included; even
+    int fieldWidth = 60;
+    int fieldLength = 60;
+    // Tiles per chunk side
+    int chunkSize = 16;
+    // Chunks kept around the focus chunk in each direction
+    int viewRadius = 4;
+};
+
+//! class ChunkMap
+/*! Map split into square chunks that are generated on demand around a
+ *! focus point. A pool of worker threads builds each chunk's instances
+ *! into pre-reserved buffers, and the render thread uploads a few
+ *! finished chunks per frame into a fixed pool of GPU slots, recycling
+ *! the slots of chunks that fell out of range. Memory stays bounded by
+ *! the pools whatever the map size.
+ */
+class ChunkMap {
+public:
+    //! Ctor.
+    //! Allocates the slot and buffer pools and starts the workers; needs a
+    //! current GL context
+    //! @param wallTAO
+    //!     Wall box textures, 2 handles
+    //! @param dryGrassTAO
+    //!     Field floor texture
+    //! @param grassTAO
+    //!     Cage floor texture
+    ChunkMap(const map_layout& layout,
+             const unsigned* wallTAO,
+             unsigned dryGrassTAO,
+             unsigned grassTAO);
+
+    //! Dtor.
+    //! Stops the workers
+    ~ChunkMap();
+
+    ChunkMap(const ChunkMap&) = delete;
+    ChunkMap& operator=(const ChunkMap&) = delete;
+
+    //! Uploads finished chunks and requests missing ones; call once per
+    //! frame before submit()
+    //! @param x, y
+    //!     Point on the ground the camera looks at
+    void update(float x, float y);
+
+    //! Generates every chunk in range of (x, y) on all workers and uploads
+    //! them, blocking until done; for startup, before the first update()
+    //! @return
+    //!     Chunks uploaded
+    unsigned load(float x, float y);
+
+    //! Queues the resident chunks inside `reffrustum`, with their grid and
+    //! wall instances culled
+    //! @param lookAt
+    //!     View matrix, for the draw order depth
+    //! @param gridProgram
+    //!     Grid program, nullptr to hide the grid
+    void submit(render::queue& refqueue,
+                const calc::frustum& reffrustum,
+                const calc::mat4f_cm& lookAt,
+                Program& tileProgram,
+                Program& wallProgram,
+                Program* gridProgram);
+
+    //! @return
+    //!     Layout the map was built with
+    const map_layout& layout() const;
+private:
+    //! struct chunk_data
+    /*! Instances of one chunk, column-major model matrices, built by a
+     *! worker; the buffers are pooled, reserved for a full chunk and
+     *! reused
+     */
+    struct chunk_data {
+        int x, y;
+        std::vector<float> grass, dryGrass, grid, wall;
+        render::cull_set gridCull, wallCull;
+    };
+
+    //! struct slot
+    /*! GPU side of one resident chunk
+     */
+    struct slot {
+        // Chunk held; valid when `used`
+        int x, y;
+        bool used;
+        // Chunk bounds, world space
+        render::aabb bounds;
+
+        render::StaticMesh grass;
+        render::StaticMesh dryGrass;
+        render::GridSquare grid;
+        render::Box wall;
+        render::cull_set gridCull;
+        render::cull_set wallCull;
+    };
+
+    //! Sets the focus chunk to the one holding (x, y)
+    void focus(float x, float y);
+
+    //! Uploads up to `limit` finished chunks still in range, dropping the
+    //! others
+    //! @return
+    //!     Chunks uploaded
+    unsigned receive(unsigned limit);
+
+    //! Hands the missing chunks in range to the workers, nearest ring
+    //! first, while buffers are free
+    void request();
+
+    //! Worker loop
+    void work();
+
+    //! Fills `refdata` with the instances of chunk (refdata.x, refdata.y)
+    void generate(chunk_data& refdata) const;
+
+    //! Moves `refdata` into a free or out-of-range slot
+    void upload(chunk_data& refdata);
+
+    //! @return
+    //!     Whether chunk (x, y) is within range of the focus chunk
+    bool in_range(int x, int y) const;
+
+    // Map dimensions
+    map_layout layout_;
+    // Chunk coordinates of the focus point
+    int focusX_ = 0;
+    int focusY_ = 0;
+
+    // GPU slots, allocated once
+    std::vector<slot> slots_;
+    // Chunk buffers, allocated once
+    std::vector<chunk_data> buffers_;
+    // Buffers not in use by the worker or awaiting upload
+    std::vector<chunk_data*> free_;
+    // Chunks requested and not uploaded yet
+    std::vector<std::pair<int, int>> inFlight_;
+
+    // Guards requests_, done_ and stop_
+    std::mutex mutex_;
+    // Signals new requests or shutdown to the workers
+    std::condition_variable wake_;
+    // Signals finished chunks to load()
+    std::condition_variable ready_;
+    // Buffers to fill, with their chunk coordinates set
+    std::vector<chunk_data*> requests_;
+    // Filled buffers awaiting upload
+    std::vector<chunk_data*> done_;
+    // Set to end the workers
+    bool stop_ = false;
+    // Chunk generators
+    std::vector<std::thread> workers_;
+};
@@ -1,9 +1,10 @@
 #include "ctrl_panel.hpp"
-#include "ball_data.hpp"
+#include "ball_system.hpp"
 #include "camera.hpp"
 #include "dear_imgui/imgui.h"
 #include "dear_imgui_backends/imgui_impl_opengl3.h"
 #include "dear_imgui_backends/imgui_impl_sdl.h"
+#include "gl_state.hpp"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengles.h>
 
@@ -29,7 +30,7 @@ CtrlPanel::CtrlPanel(SDL_Window* window)
 
 /*! Renders the entire control panel.
  */
-void CtrlPanel::render(BallData& refballData,
+void CtrlPanel::render(BallSystem& refballs,
                        Camera& refcamera,
                        const unsigned* skinHandles,
                        unsigned skinHandlesCount)
@@ -47,7 +48,7 @@ void CtrlPanel::render(BallData& refballData,
     }
 
     // Box...
-    render_ball_subpanel(refballData, skinHandles, skinHandlesCount);
+    render_ball_subpanel(refballs, skinHandles, skinHandlesCount);
 
     ImGui::Separator();
     ImGui::Dummy(ImVec2(0, 30));
@@ -58,6 +59,12 @@ void CtrlPanel::render(BallData& refballData,
     ImGui::Separator();
     ImGui::Dummy(ImVec2(0, 30));
 
+    // Renderer statistics...
+    render_stats_subpanel();
+
+    ImGui::Separator();
+    ImGui::Dummy(ImVec2(0, 30));
+
     // Scene...
     render_scene_subpanel(refcamera);
 
@@ -70,10 +77,12 @@ void CtrlPanel::render(BallData& refballData,
 
 /*! Renders the ball subpanel.
  */
-void CtrlPanel::render_ball_subpanel(BallData& refballData,
+void CtrlPanel::render_ball_subpanel(BallSystem& refballs,
                                      const unsigned* textures,
                                      unsigned textureCount) const
 {
+    BallData& refballData = refballs.controls();
+
     ImGui::Text("Box Properties");
     ImGui::Separator();
 
@@ -88,6 +97,15 @@ void CtrlPanel::render_ball_subpanel(BallData& refballData,
 
     ImGui::Separator();
 
+    // Control group
+    ImGui::SliderInt("Box count",
+                     &refballData.count,
+                     1,
+                     200000,
+                     "%d",
+                     ImGuiSliderFlags_Logarithmic);
+    ImGui::Separator();
+
     // Control group
     ImGui::SliderFloat("Box x-speed", &refballData.speed[0], 0.0f, 0.2f);
     ImGui::SliderFloat("Box y-speed", &refballData.speed[1], 0.0f, 0.2f);
@@ -104,34 +122,27 @@ void CtrlPanel::render_ball_subpanel(BallData& refballData,
 
     // Control group
     if (ImGui::Button("Stop Box"))
-        stop(refballData);
+        stop(refballs);
     ImGui::SameLine();
     if (ImGui::Button("Reset Box"))
-        reset(refballData);
+        reset(refballs);
 }
 
-/*! Stops the ball.
+/*! Stops the balls.
  */
-void CtrlPanel::stop(BallData& refballData) const
+void CtrlPanel::stop(BallSystem& refballs) const
 {
+    BallData& refballData = refballs.controls();
     refballData.speed[0] = 0;
     refballData.speed[1] = 0;
     refballData.speed[2] = 0;
 }
 
-/*! Stops the ball and resets it to its original position.
+/*! Stops the balls and resets them to their original positions.
  */
-void CtrlPanel::reset(BallData& refballData) const
+void CtrlPanel::reset(BallSystem& refballs) const
 {
-    stop(refballData);
-    refballData.turnRate[0] = 0;
-    refballData.turnRate[1] = 0;
-    refballData.turnRate[2] = 0;
-
-    refballData.translation[0][3] = 0;
-    refballData.translation[1][3] = 0;
-    refballData.direction[0] = 1.0;
-    refballData.direction[1] = 1.0;
+    refballs.reset();
 }
 
 /*! Renders the background subpanel.
@@ -150,6 +161,19 @@ void CtrlPanel::render_background_subpanel()
     ImGui::Checkbox("Enable Grid", &enableGrid);
 }
 
+/*! Renders the renderer statistics subpanel.
+ */
+void CtrlPanel::render_stats_subpanel() const
+{
+    ImGui::Text("Renderer Statistics");
+    ImGui::Separator();
+
+    // Scene draws of this frame; the panel itself is not included
+    const render::state::counters& counters = render::state::get_counters();
+    ImGui::Text("GL state changes issued: %u", counters.issued);
+    ImGui::Text("GL state changes elided: %u", counters.elided);
+}
+
 /*! Renders the scene subpanel.
  */
 void CtrlPanel::render_scene_subpanel(Camera& refcamera)
@@ -3,7 +3,7 @@
 #include <SDL2/SDL.h>
 
 // Fwd. decl.
-struct BallData;
+class BallSystem;
 // Fwd. decl.
 struct Camera;
 
@@ -28,24 +28,28 @@ struct CtrlPanel {
 
     /*! @brief Renders entire panel
      */
-    void render(BallData& refballData,
+    void render(BallSystem& refballs,
                 Camera& refcamera,
                 const unsigned* skinHandles,
                 unsigned skinHandlesCount);
 
-    void stop(BallData& refballData) const;
+    void stop(BallSystem& refballs) const;
 
-    void reset(BallData& refballData) const;
+    void reset(BallSystem& refballs) const;
 
     /*! @brief Renders subpanel segment
      */
-    void render_ball_subpanel(BallData& refballData,
+    void render_ball_subpanel(BallSystem& refballs,
                               const unsigned* textures,
                               unsigned textureCount) const;
     /*! @brief Renders subpanel segment
      */
     void render_background_subpanel();
 
+    /*! @brief Renders subpanel segment
+     */
+    void render_stats_subpanel() const;
+
     /*! @brief Renders subpanel segment
      */
     void render_scene_subpanel(Camera& refcamera);
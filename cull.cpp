@@ -0,0 +1,78 @@
+#include "cull.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+void render::init(cull_set& refset,
+                  const Drawable& refdrawable,
+                  float meshExtent)
+{
+    render::init(refset,
+                 refdrawable.instance_data(),
+                 refdrawable.instance_count(),
+                 meshExtent);
+}
+
+void render::init(cull_set& refset,
+                  const float* mat,
+                  unsigned count,
+                  float meshExtent)
+{
+    std::vector<aabb>& boxes = refset.boxes;
+    boxes.resize(count);
+
+    unsigned i = 0;
+    for (; i != count; ++i, mat += 16) {
+        // Column-major: translation in 12-14; the box around the turned
+        // and scaled mesh spans the absolute row sums
+        unsigned j = 0;
+        for (; j != 3; ++j) {
+            const float extent = meshExtent
+                                 * (std::fabs(mat[j]) + std::fabs(mat[j + 4])
+                                    + std::fabs(mat[j + 8]));
+            boxes[i].min[j] = mat[12 + j] - extent;
+            boxes[i].max[j] = mat[12 + j] + extent;
+        }
+    }
+
+    render::build(refset.tree, boxes.data(), count);
+    refset.visible.reserve(count);
+}
+
+unsigned render::cull(cull_set& refset,
+                      Drawable& refdrawable,
+                      const calc::frustum& reffrustum)
+{
+    /*ASSERT*/ assert(refset.tree.items.size()
+                      == refdrawable.instance_count());
+
+    refset.visible.clear();
+    render::query(refset.tree, reffrustum, refset.visible);
+
+    const unsigned visible = refset.visible.size();
+    if (visible == 0)
+        return 0;
+
+    // Back to instance order, so that neighbours pack together
+    std::sort(refset.visible.begin(), refset.visible.end());
+
+    const instance_format format = refdrawable.format();
+    const unsigned bytes = instance_bytes(format);
+    const float* mat = refdrawable.instance_data();
+    unsigned char* out
+        = static_cast<unsigned char*>(refdrawable.stream(visible));
+
+    // Pack each run of consecutive visible instances with one call
+    const unsigned* index = refset.visible.data();
+    unsigned i = 0;
+    while (i != visible) {
+        unsigned run = 1;
+        while (i + run != visible && index[i + run] == index[i] + run)
+            ++run;
+
+        render::pack(format, mat + index[i] * 16, run, out + i * bytes);
+        i += run;
+    }
+
+    return visible;
+}
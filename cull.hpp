@@ -0,0 +1,52 @@
+#pragma once
+
+#include "bvh.hpp"
+#include "calc/matrix.hpp"
+#include "drawable.hpp"
+#include <vector>
+
+namespace render {
+
+    //! struct cull_set
+    /*! Bounding box tree over a drawable's static instances and the
+     *! indices that passed the last culling pass
+     */
+    struct cull_set {
+        // Instance bounds, world space
+        bvh tree;
+        // The same bounds in instance order; build input, kept for its
+        // capacity
+        std::vector<aabb> boxes;
+        // Instances visible in the last pass, ascending
+        std::vector<unsigned> visible;
+    };
+
+    /*! @brief Implementation.
+     *! Rebuilds the bounds from the static instances of `refdrawable`; call
+     *! again whenever those change
+     *! @param meshExtent
+     *!     Half size of the model-space box around the origin that holds
+     *!     the whole mesh
+     */
+    void init(cull_set& refset, const Drawable& refdrawable, float meshExtent);
+
+    /*! @brief Implementation.
+     *! As above, from `count` column-major model matrices; touches no GL
+     *! state, so it may run on any thread
+     */
+    void init(cull_set& refset,
+              const float* mat,
+              unsigned count,
+              float meshExtent);
+
+    /*! @brief Implementation.
+     *! Streams the static instances of `refdrawable` that intersect
+     *! `reffrustum` for the next draw, compacted in instance order. The
+     *! static instances stay on the CPU copy; call once per frame.
+     *! @return
+     *!     # of instances streamed; nothing is streamed when 0
+     */
+    unsigned cull(cull_set& refset,
+                  Drawable& refdrawable,
+                  const calc::frustum& reffrustum);
+} // namespace render
@@ -1,11 +1,17 @@
 #include "draw_instanced_no_texture.hpp"
-#include "calc/matrix.hpp"
+#include "camera_block.hpp"
+#include <string>
 
-DrawInstancedNoTexture::DrawInstancedNoTexture()
+DrawInstancedNoTexture::DrawInstancedNoTexture(
+    render::instance_format format)
 {
-    const vertex_shader sh1 = {
+    const char* const body =
 #include "shaders/instanced_no_texture.vs"
-    };
+        ;
+
+    // Instances are read from location 1 on
+    const std::string src = render::instance_shader(format, 1) + body;
+    const vertex_shader sh1 = {src.c_str()};
 
     const fragment_shader sh2 = {
 #include "shaders/instanced_no_texture.fs"
@@ -17,19 +23,16 @@ DrawInstancedNoTexture::DrawInstancedNoTexture()
     // Link program
     Program::link();
     Program::use();
-}
 
-void DrawInstancedNoTexture::set_color(const calc::vec4f& v)
-{
-    // Set projection matrix
-    Program::set_value_vec4("color", calc::data(v));
+    color_ = Program::get_uniform<uniform::vec4>("color");
+
+    // View and projection come from the shared camera buffer
+    Program::bind_uniform_block(render::camera_block::kName,
+                                render::camera_block::kBinding);
 }
 
-void DrawInstancedNoTexture::set_scene(const calc::mat4f& lookAt,
-                                       const calc::mat4f& projection)
+void DrawInstancedNoTexture::set_color(const calc::vec4f& v)
 {
-    // Set projection matrix
-    Program::set_value_mat4x4("view", calc::data(lookAt));
-    // Set view matrix
-    Program::set_value_mat4x4("projection", calc::data(projection));
+    // Set color
+    Program::set_value(color_, calc::data(v));
 }
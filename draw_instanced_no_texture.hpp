@@ -1,6 +1,7 @@
 #pragma once
 
 #include "calc/matrix.hpp"
+#include "drawable.hpp"
 #include "program.hpp"
 
 //! class DrawInstancedNoTexture
@@ -9,10 +10,14 @@
 class DrawInstancedNoTexture : public Program {
 public:
     /*! @brief Ctor.
+     *! @param format
+     *!     Instance layout of the drawables it draws
      */
-    explicit DrawInstancedNoTexture();
+    explicit DrawInstancedNoTexture(
+        render::instance_format format = render::instance_format::mat4);
 
     void set_color(const calc::vec4f& v);
-
-    void set_scene(const calc::mat4f& lookAt, const calc::mat4f& projection);
+private:
+    // Uniform handle
+    UniformHandle<uniform::vec4> color_;
 };
@@ -1,11 +1,17 @@
 #include "draw_instanced_with_texture.hpp"
-#include "calc/matrix.hpp"
+#include "camera_block.hpp"
+#include <string>
 
-DrawInstancedWithTexture::DrawInstancedWithTexture()
+DrawInstancedWithTexture::DrawInstancedWithTexture(
+    render::instance_format format)
 {
-    const vertex_shader sh1 = {
+    const char* const body =
 #include "shaders/instanced_with_texture.vs"
-    };
+        ;
+
+    // Instances are read from location 2 on
+    const std::string src = render::instance_shader(format, 2) + body;
+    const vertex_shader sh1 = {src.c_str()};
 
     const fragment_shader sh2 = {
 #include "shaders/instanced_with_texture.fs"
@@ -22,18 +28,7 @@ DrawInstancedWithTexture::DrawInstancedWithTexture()
     Program::set_value("texture1", 0);
     Program::set_value("texture2", 1);
 
-    // Set modelview
-    Program::set_value_mat4x4("view", calc::data(calc::mat4f::identity()));
-    // Set projection
-    Program::set_value_mat4x4("projection",
-                              calc::data(calc::mat4f::identity()));
-}
-
-void DrawInstancedWithTexture::set_scene(const calc::mat4f& lookAt,
-                                         const calc::mat4f& projection)
-{
-    // Set projection matrix
-    Program::set_value_mat4x4("view", calc::data(lookAt));
-    // Set view matrix
-    Program::set_value_mat4x4("projection", calc::data(projection));
+    // View and projection come from the shared camera buffer
+    Program::bind_uniform_block(render::camera_block::kName,
+                                render::camera_block::kBinding);
 }
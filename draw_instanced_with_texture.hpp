@@ -1,6 +1,6 @@
 #pragma once
 
-#include "calc/matrix.hpp"
+#include "drawable.hpp"
 #include "program.hpp"
 
 //! class DrawInstancedWithTexture
@@ -9,8 +9,9 @@
 class DrawInstancedWithTexture : public Program {
 public:
     /*! @brief Ctor.
+     *! @param format
+     *!     Instance layout of the drawables it draws
      */
-    DrawInstancedWithTexture();
-
-    void set_scene(const calc::mat4f& lookAt, const calc::mat4f& projection);
+    explicit DrawInstancedWithTexture(
+        render::instance_format format = render::instance_format::mat4);
 };
@@ -1,13 +1,446 @@
 #include "drawable.hpp"
+#include "gl_state.hpp"
 #include "glad/glad.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    // Per-instance attribute decoding, one variant per instance_format
+    const char* const kInstanceShader =
+#include "shaders/instance_transform.vs"
+        ;
+
+    // Helper
+    // # of vec4 attribute locations an instance takes up
+    unsigned instance_columns(render::instance_format format)
+    {
+        switch (format) {
+            case render::instance_format::mat4:
+                return 4;
+            case render::instance_format::affine:
+                return 3;
+            case render::instance_format::translate_scale:
+                return 1;
+            case render::instance_format::packed:
+                return 2;
+        }
+
+        return 0;
+    }
+
+    // Helper
+    // Points the per-instance attributes at `buffer` + `offset`; the VAO
+    // must be bound
+    void bind_instance_attributes(const render::vbo& refvbo,
+                                  unsigned buffer,
+                                  std::size_t offset)
+    {
+        const unsigned stride = render::instance_bytes(refvbo.format);
+        const bool packed = refvbo.format == render::instance_format::packed;
+
+        render::state::bind_buffer(GL_ARRAY_BUFFER, buffer);
+
+        // Packed: 4 halves, then 4 normalized shorts
+        unsigned i = 0;
+        for (; i != instance_columns(refvbo.format); ++i) {
+            glVertexAttribPointer(
+                refvbo.instanceAttrib + i,
+                4,
+                packed ? (i == 0 ? GL_HALF_FLOAT : GL_SHORT) : GL_FLOAT,
+                packed && i != 0 ? GL_TRUE : GL_FALSE,
+                stride,
+                (void*)(offset + i * (packed ? 8 : 16)));
+        }
+    }
+
+#if defined(__F16C__)
+    // Helper
+    // Writes 4 floats as halves
+    void store_half4(const float* in, std::uint16_t* out)
+    {
+        _mm_storel_epi64(
+            reinterpret_cast<__m128i*>(out),
+            _mm_cvtps_ph(_mm_loadu_ps(in), _MM_FROUND_TO_NEAREST_INT));
+    }
+#else
+    // Helper
+    // @return nearest half-precision value, ties to even
+    std::uint16_t to_half(float value)
+    {
+        std::uint32_t x;
+        std::memcpy(&x, &value, sizeof(x));
+
+        const std::uint16_t sign = (x >> 16) & 0x8000;
+        x &= 0x7fffffff;
+
+        // At least 65536, infinity or NaN
+        if (x >= 0x47800000)
+            return sign | (x > 0x7f800000 ? 0x7e00 : 0x7c00);
+
+        // Normal; the rounding carry may run into the exponent
+        if (x >= 0x38800000) {
+            std::uint32_t h = (x - 0x38000000) >> 13;
+            const std::uint32_t rest = x & 0x1fff;
+            h += rest > 0x1000 || (rest == 0x1000 && (h & 1));
+            return sign | h;
+        }
+
+        // Below half the smallest subnormal
+        if (x < 0x33000000)
+            return sign;
+
+        // Subnormal
+        const unsigned shift = 126 - (x >> 23);
+        const std::uint32_t m = (x & 0x7fffff) | 0x800000;
+        std::uint32_t h = m >> shift;
+        const std::uint32_t rest = m & ((1U << shift) - 1);
+        const std::uint32_t tie = 1U << (shift - 1);
+        h += rest > tie || (rest == tie && (h & 1));
+        return sign | h;
+    }
+
+    // Helper
+    // Writes 4 floats as halves
+    void store_half4(const float* in, std::uint16_t* out)
+    {
+        unsigned i = 0;
+        for (; i != 4; ++i)
+            out[i] = to_half(in[i]);
+    }
+#endif
+
+    // Helper
+    // Rotation quaternion (x, y, z, w) of the column-major matrix `m`
+    // whose upper 3x3 is a rotation scaled by `scale`
+    void to_quaternion(const float* m, float scale, float* q)
+    {
+        auto r = [&](unsigned row, unsigned col) {
+            return m[col * 4 + row] / scale;
+        };
+
+        const float trace = r(0, 0) + r(1, 1) + r(2, 2);
+
+        // Divide by the largest component to stay well conditioned
+        if (trace > 0) {
+            const float t = 2 * std::sqrt(trace + 1);
+            q[0] = (r(2, 1) - r(1, 2)) / t;
+            q[1] = (r(0, 2) - r(2, 0)) / t;
+            q[2] = (r(1, 0) - r(0, 1)) / t;
+            q[3] = t / 4;
+        } else if (r(0, 0) > r(1, 1) && r(0, 0) > r(2, 2)) {
+            const float t = 2 * std::sqrt(1 + r(0, 0) - r(1, 1) - r(2, 2));
+            q[0] = t / 4;
+            q[1] = (r(0, 1) + r(1, 0)) / t;
+            q[2] = (r(0, 2) + r(2, 0)) / t;
+            q[3] = (r(2, 1) - r(1, 2)) / t;
+        } else if (r(1, 1) > r(2, 2)) {
+            const float t = 2 * std::sqrt(1 + r(1, 1) - r(0, 0) - r(2, 2));
+            q[0] = (r(0, 1) + r(1, 0)) / t;
+            q[1] = t / 4;
+            q[2] = (r(1, 2) + r(2, 1)) / t;
+            q[3] = (r(0, 2) - r(2, 0)) / t;
+        } else {
+            const float t = 2 * std::sqrt(1 + r(2, 2) - r(0, 0) - r(1, 1));
+            q[0] = (r(0, 2) + r(2, 0)) / t;
+            q[1] = (r(1, 2) + r(2, 1)) / t;
+            q[2] = t / 4;
+            q[3] = (r(1, 0) - r(0, 1)) / t;
+        }
+    }
+
+    // Helper
+    // Flags the blocks holding instances [first, first + count)
+    void mark_dirty(const render::shadow& refcpu,
+                    unsigned first,
+                    unsigned count)
+    {
+        if (count == 0)
+            return;
+
+        const unsigned last = (first + count - 1) / render::shadow::kBlock;
+
+        unsigned b = first / render::shadow::kBlock;
+        for (; b <= last; ++b)
+            refcpu.dirty[b / 64] |= std::uint64_t(1) << (b % 64);
+
+        refcpu.pending = true;
+    }
+
+    // Helper
+    // Sizes the CPU copy and its dirty bits for `capacity` instances,
+    // keeping the instances and bits already there
+    void resize_shadow(render::shadow& refcpu, unsigned capacity)
+    {
+        const unsigned blocks
+            = (capacity + render::shadow::kBlock - 1) / render::shadow::kBlock;
+        refcpu.data.resize(capacity * 16);
+        refcpu.dirty.resize((blocks + 63) / 64);
+    }
+
+    // Helper
+    // Makes room for `count` static instances, at least doubling the
+    // capacity so a run of push_back() calls reallocates O(log n) times
+    void grow(render::vbo& refvbo, unsigned count)
+    {
+        if (count > refvbo.instanceMax)
+            render::reserve(refvbo, std::max(count, 2 * refvbo.instanceMax));
+    }
+
+    // Helper
+    // Blocks until the GPU is done with a region, then releases its fence
+    void wait_fence(void*& fence)
+    {
+        if (fence == nullptr)
+            return;
+
+        GLsync sync = static_cast<GLsync>(fence);
+        while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000)
+               == GL_TIMEOUT_EXPIRED) {
+        }
+
+        glDeleteSync(sync);
+        fence = nullptr;
+    }
+
+    // Helper
+    // Allocates the ring; persistently mapped where buffer storage exists,
+    // in core GL 4.4 or through ARB_buffer_storage on older contexts
+    void create_ring(render::ring& refring,
+                     unsigned instanceMax,
+                     unsigned instanceBytes)
+    {
+        refring.regionBytes = instanceMax * instanceBytes;
+        const GLsizeiptr bytes = render::ring::kRegions * refring.regionBytes;
+
+        glGenBuffers(1, &refring.buffer);
+        render::state::bind_buffer(GL_ARRAY_BUFFER, refring.buffer);
+
+        if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+                                     | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+            refring.persistent = static_cast<unsigned char*>(
+                glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags));
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        }
+
+        render::state::bind_buffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Helper
+    // Releases the ring once the GPU is done with every region
+    void destroy_ring(render::ring& refring)
+    {
+        unsigned r = 0;
+        for (; r != render::ring::kRegions; ++r)
+            wait_fence(refring.fences[r]);
+
+        // Deleting the buffer also releases any mapping still held
+        render::state::delete_buffer(refring.buffer);
+
+        refring.buffer = 0;
+        refring.persistent = nullptr;
+        refring.pending = nullptr;
+    }
+
+    // Helper
+    // Releases a per-frame mapping on contexts without buffer storage
+    void unmap_pending(const render::ring& refring)
+    {
+        if (refring.pending == nullptr)
+            return;
+
+        render::state::bind_buffer(GL_ARRAY_BUFFER, refring.buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        refring.pending = nullptr;
+    }
+} // namespace
+
+unsigned render::instance_bytes(instance_format format)
+{
+    switch (format) {
+        case instance_format::mat4:
+            return 16 * sizeof(float);
+        case instance_format::affine:
+            return 12 * sizeof(float);
+        case instance_format::translate_scale:
+            return 4 * sizeof(float);
+        case instance_format::packed:
+            return 8 * sizeof(std::uint16_t);
+    }
+
+    return 0;
+}
+
+void render::pack(instance_format format,
+                  const float* mat,
+                  unsigned count,
+                  void* out)
+{
+    if (format == instance_format::mat4) {
+        std::memcpy(out, mat, count * instance_bytes(format));
+        return;
+    }
+
+    unsigned char* dst = static_cast<unsigned char*>(out);
+    float v[4];
+
+    unsigned i = 0;
+    for (; i != count; ++i, mat += 16, dst += instance_bytes(format)) {
+        if (format == instance_format::affine) {
+            // Row-wise; the constant bottom row is left out
+            unsigned row = 0;
+            for (; row != 3; ++row) {
+                const float r[4] = {
+                    mat[row], mat[4 + row], mat[8 + row], mat[12 + row]};
+                std::memcpy(dst + row * sizeof(r), r, sizeof(r));
+            }
+            continue;
+        }
+
+        // Uniform scale is the length of any basis column
+        v[0] = mat[12];
+        v[1] = mat[13];
+        v[2] = mat[14];
+        v[3] = std::sqrt(mat[0] * mat[0] + mat[1] * mat[1] + mat[2] * mat[2]);
+
+        if (format == instance_format::translate_scale) {
+            std::memcpy(dst, v, sizeof(v));
+            continue;
+        }
+
+        std::uint16_t h[8];
+        store_half4(v, h);
+
+        float q[4];
+        to_quaternion(mat, v[3], q);
+
+        unsigned j = 0;
+        for (; j != 4; ++j) {
+            const float c = std::clamp(q[j], -1.0F, 1.0F);
+            h[4 + j] = std::uint16_t(std::int16_t(std::lround(c * 32767)));
+        }
+
+        std::memcpy(dst, h, sizeof(h));
+    }
+}
+
+std::string render::instance_shader(instance_format format, unsigned location)
+{
+    return "#version 330 core\n#define INSTANCE_FORMAT "
+           + std::to_string(int(format)) + "\n#define INSTANCE_LOCATION "
+           + std::to_string(location) + "\n" + kInstanceShader;
+}
+
+unsigned render::texture_key(const tao& reftao)
+{
+    if (reftao.size == 0)
+        return 0;
+
+    // FNV-1a over the texture names; never 0 for a non-empty set
+    std::uint32_t hash = 2166136261U;
+
+    unsigned i = 0;
+    for (; i != reftao.size; ++i)
+        hash = (hash ^ reftao.tao[i]) * 16777619U;
+
+    return hash | 1;
+}
+
+void render::init(vbo& refvbo,
+                  unsigned instanceMax,
+                  unsigned instanceAttrib,
+                  instance_format format)
+{
+    refvbo = vbo();
+    refvbo.instanceMax = instanceMax;
+    refvbo.instanceAttrib = instanceAttrib;
+    refvbo.format = format;
+
+    resize_shadow(refvbo.cpu, instanceMax);
+}
+
+void render::create_instances(vbo& refvbo)
+{
+    glGenBuffers(1, &refvbo.instance);
+    render::state::bind_buffer(GL_ARRAY_BUFFER, refvbo.instance);
+
+    // Null buffer
+    glBufferData(GL_ARRAY_BUFFER,
+                 GLsizeiptr(refvbo.instanceMax) * instance_bytes(refvbo.format),
+                 nullptr,
+                 GL_STREAM_DRAW);
+    render::state::bind_buffer(GL_ARRAY_BUFFER, 0);
+
+    unsigned i = 0;
+    for (; i != instance_columns(refvbo.format); ++i) {
+        glEnableVertexAttribArray(refvbo.instanceAttrib + i);
+        glVertexAttribDivisor(refvbo.instanceAttrib + i, 1);
+    }
+
+    bind_instance_attributes(refvbo, refvbo.instance, 0);
+}
+
+void render::reserve(vbo& refvbo, unsigned count)
+{
+    if (count <= refvbo.instanceMax)
+        return;
+
+    const unsigned bytes = instance_bytes(refvbo.format);
+
+    unsigned buffer = 0;
+    glGenBuffers(1, &buffer);
+    render::state::bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER,
+                 GLsizeiptr(count) * bytes,
+                 nullptr,
+                 GL_STREAM_DRAW);
+
+    // GPU-side copy of what was uploaded so far; writes still pending in
+    // the CPU copy follow with the next flush()
+    if (refvbo.instanceCount != 0) {
+        render::state::bind_buffer(GL_COPY_READ_BUFFER, refvbo.instance);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                            GL_COPY_WRITE_BUFFER,
+                            0,
+                            0,
+                            GLsizeiptr(refvbo.instanceCount) * bytes);
+        render::state::bind_buffer(GL_COPY_READ_BUFFER, 0);
+    }
+    render::state::bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // Draws already queued keep the old storage alive until they retire
+    render::state::delete_buffer(refvbo.instance);
+    refvbo.instance = buffer;
+
+    render::state::bind_vertex_array(refvbo.mesh);
+    bind_instance_attributes(refvbo, refvbo.instance, 0);
+    render::state::bind_vertex_array(0);
+    refvbo.stream.bound = false;
+
+    refvbo.instanceMax = count;
+    resize_shadow(refvbo.cpu, count);
+}
 
 void render::modify(vbo& refvbo, const float* mat, unsigned instanceIndex)
 {
-    static const unsigned kBytes = 16 * sizeof(float);
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    /*ASSERT*/ assert(instanceIndex < refvbo.instanceMax);
 
-    unsigned off = instanceIndex * kBytes;
-    glBufferSubData(GL_ARRAY_BUFFER, off, kBytes, mat);
+    refvbo.stream.active = false;
+
+    std::copy_n(mat, 16, refvbo.cpu.data.data() + instanceIndex * 16);
+    mark_dirty(refvbo.cpu, instanceIndex, 1);
 }
 
 void render::modify(vbo& refvbo,
@@ -15,42 +448,196 @@ void render::modify(vbo& refvbo,
                     const unsigned* instanceIndices,
                     unsigned count)
 {
-    static const unsigned kBytes = 16 * sizeof(float);
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    refvbo.stream.active = false;
 
+    // Scattered writes only touch the CPU copy; flush() merges the dirty
+    // blocks into as few uploads as possible
     unsigned i = 0;
     for (; i != count; ++i) {
-        unsigned off = instanceIndices[i] * kBytes;
-        glBufferSubData(GL_ARRAY_BUFFER, off, kBytes, mat);
+        const unsigned index = instanceIndices[i];
+        /*ASSERT*/ assert(index < refvbo.instanceMax);
+
+        std::copy_n(mat + i * 16, 16, refvbo.cpu.data.data() + index * 16);
+        mark_dirty(refvbo.cpu, index, 1);
     }
 }
 
 void render::reset(vbo& refvbo, const float* mat, unsigned count)
 {
-    static const unsigned kSize = 16 * sizeof(float);
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    grow(refvbo, count);
 
+    refvbo.stream.active = false;
+
+    std::copy_n(mat, count * 16, refvbo.cpu.data.data());
+    mark_dirty(refvbo.cpu, 0, count);
     refvbo.instanceCount = count;
-    glBufferSubData(GL_ARRAY_BUFFER, 0, count * kSize, mat);
 }
 
 void render::push_back(vbo& refvbo, const float* mat)
 {
-    static const unsigned kBytes = 16 * sizeof(float);
-
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
-
-    unsigned off = refvbo.instanceCount++ * kBytes;
-    glBufferSubData(GL_ARRAY_BUFFER, off, kBytes, mat);
+    push_back(refvbo, mat, 1);
 }
 
 void render::push_back(vbo& refvbo, const float* mat, unsigned count)
 {
-    static const unsigned kBytes = 16 * sizeof(float);
+    grow(refvbo, refvbo.instanceCount + count);
 
-    glBindBuffer(GL_ARRAY_BUFFER, refvbo.instance);
+    refvbo.stream.active = false;
 
-    unsigned offset = refvbo.instanceCount * kBytes;
-    glBufferSubData(GL_ARRAY_BUFFER, offset, count * kBytes, mat);
+    std::copy_n(
+        mat, count * 16, refvbo.cpu.data.data() + refvbo.instanceCount * 16);
+    mark_dirty(refvbo.cpu, refvbo.instanceCount, count);
     refvbo.instanceCount += count;
 }
+
+void render::flush(const vbo& refvbo)
+{
+    const shadow& refcpu = refvbo.cpu;
+    if (!refcpu.pending)
+        return;
+
+    const unsigned bytes = instance_bytes(refvbo.format);
+
+    render::state::bind_buffer(GL_ARRAY_BUFFER, refvbo.instance);
+
+    // Uploads instances of blocks [first, last) that are in use, packed
+    // into the GPU format unless that is the matrix itself
+    auto upload = [&](unsigned first, unsigned last) {
+        first *= shadow::kBlock;
+        last = std::min(last * shadow::kBlock, refvbo.instanceCount);
+        if (first >= last)
+            return;
+
+        const float* src = refcpu.data.data() + first * 16;
+        const void* data = src;
+        if (refvbo.format != instance_format::mat4) {
+            refcpu.staging.resize((last - first) * bytes);
+            pack(refvbo.format, src, last - first, refcpu.staging.data());
+            data = refcpu.staging.data();
+        }
+
+        glBufferSubData(
+            GL_ARRAY_BUFFER, first * bytes, (last - first) * bytes, data);
+    };
+
+    // Runs of dirty blocks, joined across gaps of up to kBridge clean
+    // blocks; re-sending a few clean instances is cheaper than a call
+    const unsigned blocks = refcpu.dirty.size() * 64;
+    unsigned runFirst = 0;
+    unsigned runLast = 0;
+    bool open = false;
+
+    unsigned b = 0;
+    for (; b != blocks; ++b) {
+        const std::uint64_t word = refcpu.dirty[b / 64];
+        if (word == 0) {
+            b += 63 - b % 64;
+            continue;
+        }
+
+        if (!((word >> (b % 64)) & 1))
+            continue;
+
+        if (open && b <= runLast + shadow::kBridge) {
+            runLast = b + 1;
+            continue;
+        }
+
+        if (open)
+            upload(runFirst, runLast);
+
+        runFirst = b;
+        runLast = b + 1;
+        open = true;
+    }
+
+    if (open)
+        upload(runFirst, runLast);
+
+    std::fill(refcpu.dirty.begin(), refcpu.dirty.end(), 0);
+    refcpu.pending = false;
+}
+
+void* render::stream(vbo& refvbo, unsigned count)
+{
+    ring& refring = refvbo.stream;
+    const unsigned bytes = instance_bytes(refvbo.format);
+
+    // Regions are fixed in size; a larger set means a new, larger ring
+    const unsigned capacity = refring.regionBytes / bytes;
+    if (refring.buffer != 0 && count > capacity)
+        destroy_ring(refring);
+
+    if (refring.buffer == 0) {
+        create_ring(refring,
+                    std::max({count, 2 * capacity, refvbo.instanceMax, 1U}),
+                    bytes);
+    }
+
+    // Written again before any draw read it; the mapping can go
+    unmap_pending(refring);
+
+    // Move on to the region drawn from longest ago
+    refring.region = (refring.region + 1) % ring::kRegions;
+    wait_fence(refring.fences[refring.region]);
+
+    refring.count = count;
+    refring.active = true;
+
+    const unsigned offset = refring.region * refring.regionBytes;
+    if (refring.persistent != nullptr)
+        return refring.persistent + offset;
+
+    // Mapping an empty range is an error; nothing is written anyway
+    if (count == 0) {
+        static unsigned char empty;
+        return &empty;
+    }
+
+    // The fence above already guarantees the GPU is done with the range
+    render::state::bind_buffer(GL_ARRAY_BUFFER, refring.buffer);
+    refring.pending = static_cast<unsigned char*>(
+        glMapBufferRange(GL_ARRAY_BUFFER,
+                         offset,
+                         count * bytes,
+                         GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+                             | GL_MAP_INVALIDATE_RANGE_BIT));
+    return refring.pending;
+}
+
+unsigned render::begin_draw(const vbo& refvbo)
+{
+    const ring& refring = refvbo.stream;
+
+    if (!refring.active) {
+        flush(refvbo);
+
+        // Back to the static instances after a stretch of streaming
+        if (refring.bound) {
+            bind_instance_attributes(refvbo, refvbo.instance, 0);
+            refring.bound = false;
+        }
+
+        return refvbo.instanceCount;
+    }
+
+    unmap_pending(refring);
+
+    bind_instance_attributes(
+        refvbo, refring.buffer, refring.region * refring.regionBytes);
+    refring.bound = true;
+    return refring.count;
+}
+
+void render::end_draw(const vbo& refvbo)
+{
+    const ring& refring = refvbo.stream;
+    if (!refring.active)
+        return;
+
+    // A region may be drawn from for several frames; fence the last draw
+    void*& fence = refring.fences[refring.region];
+    if (fence != nullptr)
+        glDeleteSync(static_cast<GLsync>(fence));
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
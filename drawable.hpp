@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace render {
 
     //! struct tao
@@ -9,11 +13,86 @@ namespace render {
         unsigned tao[1024], size;
     };
 
+    //! enum instance_format
+    /*! Per-instance layout on the GPU. Writes always take column-major 4x4
+     *! model matrices, packed into the format on upload
+     */
+    enum class instance_format {
+        // Whole matrix; 64 bytes
+        mat4,
+        // Top three rows of an affine matrix; 48 bytes
+        affine,
+        // Translation and uniform scale, rotation dropped; 16 bytes
+        translate_scale,
+        // Half-float translation and uniform scale plus a snorm16 rotation
+        // quaternion; 16 bytes, rigid motion only
+        packed
+    };
+
+    //! struct ring
+    /*! Triple-buffered stream of instance matrices. Each stream() call
+     *! writes a whole instance set into the next region of one large buffer
+     *! while the GPU may still be reading the other two; a fence per region
+     *! keeps the CPU from overwriting data in flight
+     */
+    struct ring {
+        static constexpr unsigned kRegions = 3;
+
+        // Buffer holding all regions; 0 until the first stream() call
+        unsigned buffer;
+        // Region size in bytes
+        unsigned regionBytes;
+        // Region last written
+        unsigned region;
+        // # of instances in that region
+        unsigned count;
+        // Whether draws read from the ring rather than the static buffer
+        bool active;
+        // Whether the instance attributes currently point into the ring
+        mutable bool bound;
+        // Whole-buffer mapping, kept for the buffer's lifetime (GL 4.4 or
+        // ARB_buffer_storage); nullptr without buffer storage
+        unsigned char* persistent;
+        // Per-frame mapping awaiting unmap without buffer storage
+        mutable unsigned char* pending;
+        // GLsync per region, set after each draw from that region
+        mutable void* fences[kRegions];
+    };
+
+    //! struct shadow
+    /*! CPU copy of the static instances. Writes land here and flag their
+     *! blocks dirty; flush() uploads each run of dirty blocks with one call
+     */
+    struct shadow {
+        // # of instances per dirty bit
+        static constexpr unsigned kBlock = 32;
+        // Longest gap of clean blocks merged into a surrounding upload
+        static constexpr unsigned kBridge = 1;
+
+        // Packed instance matrices, sized to the instance capacity
+        std::vector<float> data;
+        // One bit per block of kBlock instances
+        mutable std::vector<std::uint64_t> dirty;
+        // Dirty instances converted to the GPU format, reused across flushes
+        mutable std::vector<unsigned char> staging;
+        // Whether any block is dirty
+        mutable bool pending = false;
+    };
+
     //! struct vbo
     /*! OpenGL VBOs
      */
     struct vbo {
         unsigned mesh, instance, vertex, instanceCount;
+        // Instance capacity, grown on demand, and first of the 4
+        // per-instance matrix attributes
+        unsigned instanceMax, instanceAttrib;
+        // Layout of the instance buffers
+        instance_format format;
+        // Static instances, CPU side
+        shadow cpu;
+        // Streaming instances
+        ring stream;
     };
 
     //! class Drawable
@@ -32,8 +111,13 @@ namespace render {
         //!     Model matrix.
         virtual void modify(const float* mat, unsigned instanceIndex) = 0;
 
+        //! Updates scattered instances; indices may come in any order, and
+        //! runs of nearby indices are uploaded together on flush()
         //! @param mat
-        //!     Array of model matrices.
+        //!     Array of model matrices, one per index.
+        //! @param instanceIndices
+        //!     Instance to update with each matrix; for repeated indices
+        //!     the last matrix wins.
         //! @param size
         //!     Size of array.
         virtual void modify(const float* mat,
@@ -58,8 +142,101 @@ namespace render {
         //! @param size
         //!     Size of array.
         virtual void push_back(const float* mat, unsigned size) = 0;
+
+        //! Uploads every write since the last flush, one call per run of
+        //! dirty instances. draw() flushes on its own; calling this once
+        //! per frame up front keeps uploads out of the draw sequence.
+        virtual void flush() = 0;
+
+        //! @return
+        //!     CPU copy of the static instances, instance_count() packed
+        //!     matrices; readable without touching GL
+        virtual const float* instance_data() const = 0;
+
+        //! @return
+        //!     # of static instances
+        virtual unsigned instance_count() const = 0;
+
+        //! Grows the instance capacity to at least `count`, keeping the
+        //! current instances. Writes past the capacity grow it on their
+        //! own, doubling each time; reserving up front saves the copies.
+        virtual void reserve(unsigned count) = 0;
+
+        //! @return
+        //!     Layout of the instances on the GPU
+        virtual instance_format format() const = 0;
+
+        //! @return
+        //!     VAO bound by draw()
+        virtual unsigned vertex_array() const = 0;
+
+        //! @return
+        //!     Key shared by drawables binding the same textures, 0 for
+        //!     none; distinct sets may collide
+        virtual unsigned texture_key() const = 0;
+
+        //! Replaces all instances for the following draws with `count`
+        //! instances written straight into mapped GPU memory; meant for
+        //! instance sets rebuilt every frame. The static instances set
+        //! through reset()/modify()/push_back() are drawn again once one of
+        //! those is called.
+        //! @param count
+        //!     # of instances to write; may exceed the instance capacity,
+        //!     and 0 makes the next draw() draw nothing
+        //! @return
+        //!     Write-only destination for `count` instances in format(),
+        //!     valid until the next draw() or stream(); render::pack()
+        //!     fills it from matrices. Never nullptr
+        virtual void* stream(unsigned count) = 0;
     };
 
+    /*! @return
+     *!     Bytes per instance in `format`
+     */
+    unsigned instance_bytes(instance_format format);
+
+    /*! Converts column-major 4x4 model matrices to `format`
+     *! @param out
+     *!     Destination for `count` * instance_bytes(format) bytes
+     */
+    void pack(instance_format format,
+              const float* mat,
+              unsigned count,
+              void* out);
+
+    /*! @return
+     *!     Start of a vertex shader reading instances in `format` from
+     *!     attribute `location` on: the #version line and the per-instance
+     *!     inputs, plus `vec4 instance_transform(vec3 p)`, which takes a
+     *!     model-space position to world space
+     */
+    std::string instance_shader(instance_format format, unsigned location);
+
+    /*! @return
+     *!     Hash of the texture set in `reftao`, 0 when it is empty
+     */
+    unsigned texture_key(const tao& reftao);
+
+    /*! @brief Implementation.
+     *! Clears `refvbo` and allocates the CPU copy of its instances
+     */
+    void init(vbo& refvbo,
+              unsigned instanceMax,
+              unsigned instanceAttrib,
+              instance_format format);
+
+    /*! @brief Implementation.
+     *! Allocates the instance buffer and enables the per-instance
+     *! attributes; call with the VAO bound
+     */
+    void create_instances(vbo& refvbo);
+
+    /*! @brief Implementation.
+     *! Moves the instances into a buffer with room for `count`, copying on
+     *! the GPU; the VAO binding is reset to 0
+     */
+    void reserve(vbo& refvbo, unsigned count);
+
     /*! @brief Impl.
      */
     void modify(vbo& refvbo, const float* mat, unsigned instanceIndex);
@@ -82,4 +259,23 @@ namespace render {
     /*! @brief Implementation.
      */
     void push_back(vbo& refvbo, const float* mat, unsigned count);
+
+    /*! @brief Implementation.
+     */
+    void flush(const vbo& refvbo);
+
+    /*! @brief Implementation.
+     */
+    void* stream(vbo& refvbo, unsigned count);
+
+    /*! @brief Points the instance attributes at the static buffer or the
+     *! ring, whichever holds the current instance set, flushing pending
+     *! static writes; call with the VAO bound, right before drawing
+     *! @return # of instances to draw
+     */
+    unsigned begin_draw(const vbo& refvbo);
+
+    /*! @brief Fences the ring region that was just drawn from
+     */
+    void end_draw(const vbo& refvbo);
 } // namespace render
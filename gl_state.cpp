@@ -0,0 +1,146 @@
+#include "gl_state.hpp"
+#include "glad/glad.h"
+#include <algorithm>
+
+namespace {
+
+    // Helper
+    // Binding value meaning "unknown"; never a valid GL name
+    constexpr unsigned kUnknown = ~0U;
+
+    // Helper
+    // # of texture units tracked; binds on higher units always go through
+    constexpr unsigned kUnits = 16;
+
+    // Helper
+    // Tracked buffer targets
+    constexpr GLenum kTargets[] = {GL_ARRAY_BUFFER,
+                                   GL_UNIFORM_BUFFER,
+                                   GL_COPY_READ_BUFFER,
+                                   GL_COPY_WRITE_BUFFER};
+
+    constexpr unsigned kTargetCount = sizeof(kTargets) / sizeof(kTargets[0]);
+
+    // Helper
+    // Current bindings
+    struct bindings {
+        unsigned program = kUnknown;
+        unsigned vao = kUnknown;
+        unsigned unit = kUnknown;
+        unsigned textures[kUnits];
+        unsigned buffers[kTargetCount];
+
+        bindings()
+        {
+            std::fill_n(textures, kUnits, kUnknown);
+            std::fill_n(buffers, kTargetCount, kUnknown);
+        }
+    };
+
+    bindings g_bindings;
+    render::state::counters g_counters = {0, 0};
+
+    // Helper
+    // @return
+    //     Whether `current` needs to change to `value`; records the
+    //     outcome in the counters and `current`
+    bool change(unsigned& current, unsigned value)
+    {
+        if (current == value) {
+            ++g_counters.elided;
+            return false;
+        }
+
+        ++g_counters.issued;
+        current = value;
+        return true;
+    }
+
+    // Helper
+    // @return
+    //     Slot of `target` in bindings::buffers, kTargetCount if untracked
+    unsigned target_slot(unsigned target)
+    {
+        return std::find(kTargets, kTargets + kTargetCount, target) - kTargets;
+    }
+} // namespace
+
+void render::state::use_program(unsigned program)
+{
+    if (change(g_bindings.program, program))
+        glUseProgram(program);
+}
+
+void render::state::bind_vertex_array(unsigned vao)
+{
+    if (change(g_bindings.vao, vao))
+        glBindVertexArray(vao);
+}
+
+void render::state::bind_texture(unsigned unit, unsigned texture)
+{
+    if (unit < kUnits && g_bindings.textures[unit] == texture) {
+        ++g_counters.elided;
+        return;
+    }
+
+    if (change(g_bindings.unit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+
+    ++g_counters.issued;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (unit < kUnits)
+        g_bindings.textures[unit] = texture;
+}
+
+void render::state::bind_buffer(unsigned target, unsigned buffer)
+{
+    const unsigned slot = target_slot(target);
+    if (slot == kTargetCount) {
+        ++g_counters.issued;
+        glBindBuffer(target, buffer);
+        return;
+    }
+
+    if (change(g_bindings.buffers[slot], buffer))
+        glBindBuffer(target, buffer);
+}
+
+void render::state::bind_buffer_base(unsigned target,
+                                     unsigned index,
+                                     unsigned buffer)
+{
+    ++g_counters.issued;
+    glBindBufferBase(target, index, buffer);
+
+    const unsigned slot = target_slot(target);
+    if (slot != kTargetCount)
+        g_bindings.buffers[slot] = buffer;
+}
+
+void render::state::delete_buffer(unsigned buffer)
+{
+    glDeleteBuffers(1, &buffer);
+
+    // GL unbinds a deleted buffer; its name may come back from glGenBuffers
+    unsigned i = 0;
+    for (; i != kTargetCount; ++i) {
+        if (g_bindings.buffers[i] == buffer)
+            g_bindings.buffers[i] = 0;
+    }
+}
+
+void render::state::invalidate()
+{
+    g_bindings = bindings();
+}
+
+const render::state::counters& render::state::get_counters()
+{
+    return g_counters;
+}
+
+void render::state::reset_counters()
+{
+    g_counters = {0, 0};
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+namespace render {
+
+    //! namespace state
+    /*! Mirror of the GL bindings the renderer changes: current program,
+     *! VAO, 2D texture per unit and the buffer targets in use. Binds go
+     *! through here and are dropped when they would change nothing. Code
+     *! that binds behind its back (e.g. Dear ImGui) must be followed by
+     *! invalidate().
+     */
+    namespace state {
+
+        //! struct counters
+        /*! GL calls issued and elided since the last reset_counters()
+         */
+        struct counters {
+            unsigned issued;
+            unsigned elided;
+        };
+
+        //! glUseProgram
+        void use_program(unsigned program);
+
+        //! glBindVertexArray
+        void bind_vertex_array(unsigned vao);
+
+        //! glActiveTexture plus glBindTexture(GL_TEXTURE_2D)
+        void bind_texture(unsigned unit, unsigned texture);
+
+        //! glBindBuffer; array, uniform and copy targets are tracked
+        void bind_buffer(unsigned target, unsigned buffer);
+
+        //! glBindBufferBase; also binds `buffer` to `target` itself
+        void bind_buffer_base(unsigned target, unsigned index, unsigned buffer);
+
+        //! glDeleteBuffers; drops the deleted buffer from the bindings
+        void delete_buffer(unsigned buffer);
+
+        //! Forgets every binding; the next bind of each kind is issued
+        void invalidate();
+
+        //! @return
+        //!     Calls issued and elided since the last reset_counters()
+        const counters& get_counters();
+
+        //! Zeroes the counters; call once per frame
+        void reset_counters();
+    } // namespace state
+} // namespace render
@@ -1,4 +1,5 @@
 #include "grid_square.hpp"
+#include "gl_state.hpp"
 #include "glad/glad.h"
 #include "texture.hpp"
 #include <cstring>
@@ -6,7 +7,7 @@
 namespace {
 
     // Square
-    static const float kVertices[] = {
+    constexpr float kVertices[] = {
         -0.5f, -0.5f, -0.5f,
         +0.5f, -0.5f, -0.5f,
         +0.5f,  0.5f, -0.5f,
@@ -16,16 +17,17 @@ namespace {
     };
 } // namespace
 
-render::GridSquare::GridSquare(unsigned instanceSizeMax)
+render::GridSquare::GridSquare(unsigned instanceSizeMax,
+                               instance_format format)
 {
-    std::memset(&vbo_, 0, sizeof(vbo_));
+    render::init(vbo_, instanceSizeMax, 1, format);
 
     // Initialize OpenGL buffers
     glGenVertexArrays(1, &vbo_.mesh);
-    glBindVertexArray(vbo_.mesh);
+    render::state::bind_vertex_array(vbo_.mesh);
 
     glGenBuffers(1, &vbo_.vertex);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_.vertex);
+    render::state::bind_buffer(GL_ARRAY_BUFFER, vbo_.vertex);
 
     // Add vertices
     glBufferData(
@@ -36,60 +38,21 @@ render::GridSquare::GridSquare(unsigned instanceSizeMax)
         0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(0));
 
     // Instancing
-    glGenBuffers(1, &vbo_.instance);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_.instance);
+    render::create_instances(vbo_);
 
-    // Null buffer
-    glBufferData(GL_ARRAY_BUFFER,
-                 instanceSizeMax * 16 * sizeof(float),
-                 nullptr,
-                 GL_STREAM_DRAW);
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(
-        1, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(0));
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2,
-                          4,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          16 * sizeof(float),
-                          (void*)(4 * sizeof(float)));
-
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3,
-                          4,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          16 * sizeof(float),
-                          (void*)(8 * sizeof(float)));
-
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4,
-                          4,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          16 * sizeof(float),
-                          (void*)(12 * sizeof(float)));
-
-    glVertexAttribDivisor(1, 1);
-    glVertexAttribDivisor(2, 1);
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    render::state::bind_buffer(GL_ARRAY_BUFFER, 0);
+    render::state::bind_vertex_array(0);
 }
 
 void render::GridSquare::draw() const
 {
-    static const unsigned kVertexSize = sizeof(kVertices) / sizeof(float) / 3;
-    glBindVertexArray(vbo_.mesh);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    constexpr unsigned kVertexSize = sizeof(kVertices) / sizeof(float) / 3;
+    static_assert(kVertexSize * 3 * sizeof(float) == sizeof(kVertices));
+    render::state::bind_vertex_array(vbo_.mesh);
     // Draw
     glDrawArraysInstanced(
-        GL_LINE_STRIP_ADJACENCY, 0, kVertexSize, vbo_.instanceCount);
+        GL_LINE_STRIP_ADJACENCY, 0, kVertexSize, render::begin_draw(vbo_));
+    render::end_draw(vbo_);
 }
 
 void render::GridSquare::modify(const float* mat, unsigned instanceIndex)
@@ -118,3 +81,43 @@ void render::GridSquare::push_back(const float* mat, unsigned size)
 {
     render::push_back(vbo_, mat, size);
 }
+
+void render::GridSquare::flush()
+{
+    render::flush(vbo_);
+}
+
+const float* render::GridSquare::instance_data() const
+{
+    return vbo_.cpu.data.data();
+}
+
+unsigned render::GridSquare::instance_count() const
+{
+    return vbo_.instanceCount;
+}
+
+void render::GridSquare::reserve(unsigned count)
+{
+    render::reserve(vbo_, count);
+}
+
+render::instance_format render::GridSquare::format() const
+{
+    return vbo_.format;
+}
+
+unsigned render::GridSquare::vertex_array() const
+{
+    return vbo_.mesh;
+}
+
+unsigned render::GridSquare::texture_key() const
+{
+    return 0;
+}
+
+void* render::GridSquare::stream(unsigned count)
+{
+    return render::stream(vbo_, count);
+}
@@ -13,8 +13,11 @@ namespace render {
 
         //! Ctor.
         //! @param instanceSizeMax
-        //!     The maximum # of instances to allocate
-        explicit GridSquare(unsigned instanceSizeMax);
+        //!     The initial # of instances to allocate; grows on demand
+        //! @param format
+        //!     Instance layout on the GPU; must match the drawing program
+        explicit GridSquare(unsigned instanceSizeMax,
+                            instance_format format = instance_format::mat4);
 
         void draw() const override;
 
@@ -29,6 +32,22 @@ namespace render {
         void push_back(const float* mat) override;
 
         void push_back(const float* mat, unsigned size) override;
+
+        void flush() override;
+
+        const float* instance_data() const override;
+
+        unsigned instance_count() const override;
+
+        void reserve(unsigned count) override;
+
+        instance_format format() const override;
+
+        unsigned vertex_array() const override;
+
+        unsigned texture_key() const override;
+
+        void* stream(unsigned count) override;
     private:
         // Vertex handles
         vbo vbo_;
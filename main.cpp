@@ -1,24 +1,27 @@
-#include "ball_data.hpp"
+#include "ball_system.hpp"
 #include "box.hpp"
 #include "camera.hpp"
+#include "camera_block.hpp"
+#include "chunk_map.hpp"
 #include "ctrl_panel.hpp"
 #include "dear_imgui/imgui.h"
 #include "dear_imgui_backends/imgui_impl_opengl3.h"
 #include "dear_imgui_backends/imgui_impl_sdl.h"
 #include "draw_instanced_no_texture.hpp"
 #include "draw_instanced_with_texture.hpp"
+#include "gl_state.hpp"
 #include "glad/glad.h"
-#include "grid_square.hpp"
 #include "images/awesome_face.h"
 #include "images/brick_wall.h"
 #include "images/incredulous_face.h"
 #include "images/shocked_face.h"
 #include "images/tiles/dark_grass.h"
 #include "images/tiles/dry_grass.h"
-#include "square.hpp"
+#include "render_queue.hpp"
 #include "texture.hpp"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -90,112 +93,6 @@ namespace {
     }
 } // namespace
 
-namespace {
-
-    /*! Helper
-     *! Builds the vertices for the map grid
-     */
-    std::vector<calc::mat4f> build_grid(int width, int length)
-    {
-        static const float xdim = 1.0;
-        static const float ydim = 1.0;
-
-        calc::mat4f model = calc::mat4f::identity();
-        float& x = model[3][0];
-        float& y = model[3][1];
-
-        const int xinst = std::ceil(width / 2.0 / xdim);
-        const int yinst = std::ceil(length / 2.0 / ydim);
-
-        const int size = xinst * yinst * 4;
-
-        std::vector<calc::mat4f> grid;
-        grid.resize(size);
-        calc::mat4f* ptr = &grid[0];
-
-        for (int i = -xinst; i != xinst; ++i) {
-            for (int j = -yinst; j != yinst; ++j) {
-                x = i * xdim + 0.5;
-                y = j * ydim + 0.5;
-                *ptr++ = model;
-            }
-        }
-
-        return grid;
-    }
-
-    /*! Helper
-     *! Build the vertices for the map wall
-     */
-    std::vector<calc::mat4f> build_wall(int width, int length)
-    {
-        std::vector<calc::mat4f> wall;
-
-        // West wall
-        for (int i = 1 - length / 2 / 3; i != length / 2 / 3; ++i) {
-            calc::mat4f mat = calc::mat4f::identity();
-            mat[0][0] = 3;
-            mat[1][1] = 3;
-
-            mat[0][3] = width / 2 - 1;
-            mat[1][3] = i * 3;
-            mat[2][3] = -1.0;
-            wall.push_back(calc::transpose(mat));
-        }
-
-        // East wall
-        for (int i = 1 - length / 2 / 3; i != length / 2 / 3; ++i) {
-            calc::mat4f mat = calc::mat4f::identity();
-            mat[0][0] = 3;
-            mat[1][1] = 3;
-
-            mat[0][3] = 1 - width / 2;
-            mat[1][3] = i * 3;
-            mat[2][3] = -1.0;
-            wall.push_back(calc::transpose(mat));
-        }
-
-        // North wall
-        for (int i = 1 - width / 2 / 3; i != width / 2 / 3; ++i) {
-            calc::mat4f mat = calc::mat4f::identity();
-            mat[0][0] = 3;
-            mat[1][1] = 3;
-
-            mat[0][3] = i * 3;
-            mat[1][3] = length / 2 - 1;
-            mat[2][3] = -1.0;
-            wall.push_back(calc::transpose(mat));
-        }
-
-        // South wall
-        for (int i = 1 - width / 2 / 3; i != width / 2 / 3; ++i) {
-            calc::mat4f mat = calc::mat4f::identity();
-            mat[0][0] = 3;
-            mat[1][1] = 3;
-
-            mat[0][3] = i * 3;
-            mat[1][3] = 1 - length / 2;
-            mat[2][3] = -1.0;
-            wall.push_back(calc::transpose(mat));
-        }
-
-        return wall;
-    }
-
-    /*! Helper
-     *! Converts matrix to float data
-     */
-    inline std::vector<float> copy_matrix_data(
-        const std::vector<calc::mat4f>& mats)
-    {
-        std::vector<float> values(mats.size() * 16);
-        for (::size_t i = 0; i != mats.size(); ++i)
-            std::memcpy(
-                &values[i * 16], calc::data(mats[i]), sizeof(calc::mat4f));
-        return values;
-    }
-} // namespace
-
 namespace {
 
     /*! Class Runner
@@ -210,8 +107,10 @@ namespace {
             , panel_(window)
             , camera_(camera)
         {
-            static const unsigned width = 30;
-            static const unsigned height = 30;
+            static constexpr unsigned width = 30;
+            static constexpr unsigned height = 30;
+
+            render::init(cameraBlock_);
 
             // Load boxes
             unsigned boxTAO1[]
@@ -243,130 +142,54 @@ namespace {
                 incredulous_face_png, incredulous_face_png_len, true, false));
 
             ballObject_[0]
-                = render::Box(boxTAO1, (sizeof(boxTAO1) / sizeof(unsigned)), 1);
+                = render::Box(boxTAO1,
+                              (sizeof(boxTAO1) / sizeof(unsigned)),
+                              1,
+                              render::instance_format::packed);
             ballObject_[0].push_back(calc::mat4f::identity());
 
             ballObject_[1]
-                = render::Box(boxTAO2, (sizeof(boxTAO2) / sizeof(unsigned)), 1);
+                = render::Box(boxTAO2,
+                              (sizeof(boxTAO2) / sizeof(unsigned)),
+                              1,
+                              render::instance_format::packed);
             ballObject_[1].push_back(calc::mat4f::identity());
 
             ballObject_[2]
-                = render::Box(boxTAO3, (sizeof(boxTAO3) / sizeof(unsigned)), 1);
+                = render::Box(boxTAO3,
+                              (sizeof(boxTAO3) / sizeof(unsigned)),
+                              1,
+                              render::instance_format::packed);
             ballObject_[2].push_back(calc::mat4f::identity());
 
-            // Load map...
-            float cageWidth = width + (width % 2);
-            cageWidth_ = cageWidth;
-
-            float cageLength = height + (height % 2);
-            cageLength_ = cageLength;
-
-            float gridWidth = 2 * cageWidth;
-            float gridLength = 2 * cageLength;
-
-            // Load grid tiles
-            const std::vector<float> grid
-                = copy_matrix_data(build_grid(gridWidth, gridLength));
-            gridTile_ = render::GridSquare((gridWidth * gridLength));
-            gridTile_.reset(grid.data(), (grid.size() / 16));
-
-            // Load wall
-            const std::vector<float> wall
-                = copy_matrix_data(build_wall(cageWidth, cageLength));
-            wallObject_ = render::Box(wallTAO,
-                                      (sizeof(wallTAO) / sizeof(unsigned)),
-                                      (cageWidth * cageLength));
-            wallObject_.reset(wall.data(), (wall.size() / 16));
-
-            // Load dry grass tiles...
-            unsigned dryGrassTextureTAO = render::load_texture_from_data(
-                dry_grass_png, dry_grass_png_len, false);
-            unsigned dryGrassTileTAO[]
-                = {dryGrassTextureTAO, dryGrassTextureTAO};
-
-            dryGrassTile_
-                = render::Square(dryGrassTileTAO,
-                                 sizeof(dryGrassTileTAO) / sizeof(unsigned),
-                                 gridWidth * gridLength);
-
-            int gridMaxLength = gridLength / 2;
-            int gridMinLength = -gridMaxLength;
-
-            int gridMaxWidth = gridWidth / 2;
-            int gridMinWidth = -gridMaxWidth;
-
-            int cageMaxLength = cageLength / 2;
-            int cageMinLength = -cageMaxLength;
-
-            int cageMaxWidth = cageWidth / 2;
-            int cageMinWidth = -cageMaxWidth;
-
-            // Load dry grass coordinates
-            calc::mat4f mat = calc::mat4f::identity();
-
-            // Top field
-            for (int i = cageMaxLength; i <= gridMaxLength; ++i) {
-                for (int j = gridMinWidth; j <= gridMaxWidth; ++j) {
-                    mat[3][0] = j;
-                    mat[3][1] = i;
-                    dryGrassTile_.push_back(mat);
-                }
-            }
-
-            // Right field
-            for (int i = cageMinLength; i <= cageMaxLength; ++i) {
-                for (int j = gridMinWidth; j <= cageMinWidth + 1; ++j) {
-                    mat[3][0] = j;
-                    mat[3][1] = i;
-                    dryGrassTile_.push_back(mat);
-                }
-            }
-
-            // Left field
-            for (int i = cageMinLength; i <= cageMaxLength; ++i) {
-                for (int j = cageMaxWidth - 1; j <= gridMaxWidth; ++j) {
-                    mat[3][0] = j;
-                    mat[3][1] = i;
-                    dryGrassTile_.push_back(mat);
-                }
-            }
-
-            // Bottom field
-            for (int i = gridMinLength; i <= cageMinLength; ++i) {
-                for (int j = gridMinWidth; j <= gridMaxWidth; ++j) {
-                    mat[3][0] = j;
-                    mat[3][1] = i;
-                    dryGrassTile_.push_back(mat);
-                }
-            }
-
-            // Load fresh grass tiles...
-            unsigned grassTextureTAO = render::load_texture_from_data(
-                dark_grass_png, dark_grass_png_len, false);
-            unsigned grassTileTAO[] = {grassTextureTAO, grassTextureTAO};
-
-            grassTile_ = render::Square(grassTileTAO,
-                                        sizeof(grassTileTAO) / sizeof(unsigned),
-                                        cageWidth * cageLength);
-
-            const int wallThickness = 2;
-
-            // Load fresh grass coordinates
-            for (int i = cageMinLength + wallThickness;
-                 i <= cageMaxLength - wallThickness;
-                 ++i) {
-                for (int j = cageMinWidth + wallThickness;
-                     j <= cageMaxWidth - wallThickness;
-                     ++j) {
-                    grassTile_.push_back(calc::transpose([i, j]() {
-                        calc::mat4f mat = calc::mat4f::identity();
-                        mat[0][3] = j;
-                        mat[1][3] = i;
-                        mat[2][3] = 0;
-                        return mat;
-                    }()));
-                }
-            }
+            // Load map; the cage inside a dry grass field twice its size,
+            // generated in chunks around the camera
+            map_layout layout;
+            layout.cageWidth = width + (width % 2);
+            layout.cageLength = height + (height % 2);
+            layout.fieldWidth = 2 * layout.cageWidth;
+            layout.fieldLength = 2 * layout.cageLength;
+
+            cageWidth_ = layout.cageWidth;
+            cageLength_ = layout.cageLength;
+
+            map_ = std::make_unique<ChunkMap>(
+                layout,
+                wallTAO,
+                render::load_texture_from_data(
+                    dry_grass_png, dry_grass_png_len, false),
+                render::load_texture_from_data(
+                    dark_grass_png, dark_grass_png_len, false));
+
+            // Build the chunks around the origin up front on all workers
+            const unsigned ticks = SDL_GetTicks();
+            const unsigned chunks = map_->load(0, 0);
+            printf("Map ready in %u ms (%u chunks)\n",
+                   SDL_GetTicks() - ticks,
+                   chunks);
+
+            // The first step covers one frame, not the startup
+            lastTicks_ = SDL_GetTicks();
         }
 
         /*! Run loop
@@ -454,8 +277,30 @@ namespace {
                          1.0);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            const calc::mat4f& lookAt = camera_->get_device_look_at();
-            const calc::mat4f& projection = camera_->get_device_projection();
+            // Count this frame's state changes from here
+            render::state::reset_counters();
+
+            // Camera uniforms for every program, once per frame
+            render::update(cameraBlock_,
+                           camera_->get_device_look_at(),
+                           camera_->get_device_projection());
+
+            const calc::mat4f_cm& lookAt = camera_->get_device_look_at();
+
+            // Stream the map around the ground point at the screen center
+            const ray center = camera_->unproject(
+                camera_->get_screen_width() / 2,
+                camera_->get_screen_height() / 2);
+            float t = 0;
+            if (center.direction[2] != 0)
+                t = std::max(-center.origin[2] / center.direction[2], 0.0F);
+            map_->update(center.origin[0] + t * center.direction[0],
+                         center.origin[1] + t * center.direction[1]);
+
+            // Chunks, grid and wall instances outside the view are left out
+            // of the frame's uploads and draws
+            const calc::frustum frustum
+                = calc::frustum_planes(camera_->get_scene());
 
             // Maybe draw the grid
             if (panel_.enableGrid) {
@@ -464,56 +309,36 @@ namespace {
                                                 panel_.gridColor[1],
                                                 panel_.gridColor[2],
                                                 1.0));
-                gridDraw_.set_scene(lookAt, projection);
-                gridTile_.draw();
             }
 
-            // Draw the wall
-            mainDraw_.use();
-            mainDraw_.set_scene(lookAt, projection);
-            wallObject_.draw();
-
-            // Draw the grass outside the cage
-            dryGrassTile_.draw();
-            // Draw the grass inside the cage
-            grassTile_.draw();
-
-            // Draw the box
-            calc::vec3f& direction = ballData_.direction;
-            calc::vec3f& speed = ballData_.speed;
-            calc::mat4f& translation = ballData_.translation;
-
-            translation[2][3] = -1.0;
-            float x = (translation[0][3] += speed[0] * direction[0]);
-            float y = (translation[1][3] += speed[1] * direction[1]);
-
-            // Bounce back on wall hit
-            float hitOffset = 3.0;
-            if (x < +hitOffset - (cageWidth_ / 2)
-                || x > -hitOffset + (cageWidth_ / 2)) {
-                direction[0] *= -1;
-            }
+            // Draw the map
+            map_->submit(queue_,
+                         frustum,
+                         lookAt,
+                         tileDraw_,
+                         wallDraw_,
+                         panel_.enableGrid ? &gridDraw_ : nullptr);
 
-            if (y < +hitOffset - (cageLength_ / 2)
-                || y > -hitOffset + (cageLength_ / 2)) {
-                direction[1] *= -1;
-            }
+            // Move the balls; turn rates are in tenths of a degree per ms
+            const unsigned ticks = SDL_GetTicks();
+            balls_.step(float(ticks - lastTicks_),
+                        cageWidth_ / 2,
+                        cageLength_ / 2);
+            lastTicks_ = ticks;
 
-            const calc::vec3f turnRate
-                = ballData_.turnRate * calc::radians(SDL_GetTicks() / 10.0);
-            const calc::mat4f boxMat = calc::transpose(
-                translation * calc::rotate_4x(turnRate[0])
-                * calc::rotate_4y(turnRate[1]) * calc::rotate_4z(turnRate[2]));
+            // Draw the balls, one instanced box per skin
+            balls_.submit(queue_, lookAt, ballObject_, ballDraw_);
 
-            render::Box& refobject = ballObject_[ballData_.selectedSkin];
-            refobject.modify(calc::data(boxMat), 0);
-            refobject.draw();
+            // Issue the frame's draws, sorted by state and depth
+            render::flush(queue_);
 
             // Draw the control panel
-            panel_.render(ballData_,
+            panel_.render(balls_,
                           *camera_,
                           textureHandles_.data(),
                           textureHandles_.size());
+            // Dear ImGui binds its own program, VAO and textures
+            render::state::invalidate();
             // Update screen & return
             SDL_GL_SwapWindow(window_);
         }
@@ -526,26 +351,35 @@ namespace {
 
         // Camera / viewer
         Camera* camera_;
-        // Contains ball position and rotation information
-        BallData ballData_;
+        // Ball positions, velocities and rotations
+        BallSystem balls_{3};
+        // Time of the previous frame, ms
+        unsigned lastTicks_ = 0;
+
+        // Camera uniforms shared by all programs
+        render::camera_block cameraBlock_;
+        // Draws of the current frame
+        render::queue queue_;
 
         // Program, uses instancing;
         // called to draw grid squares
-        DrawInstancedNoTexture gridDraw_;
+        DrawInstancedNoTexture gridDraw_{
+            render::instance_format::translate_scale};
         // Program, uses instancing;
-        // called to draw all textured objects
-        DrawInstancedWithTexture mainDraw_;
-
-        // Map item
-        render::Square grassTile_;
-        // Map item
-        render::Square dryGrassTile_;
-        // Map item
-        render::GridSquare gridTile_;
-        // Map item
+        // called to draw the wall; 3x4 affine instances
+        DrawInstancedWithTexture wallDraw_{render::instance_format::affine};
+        // Program, uses instancing;
+        // called to draw the baked grass chunks; one identity instance each
+        DrawInstancedWithTexture tileDraw_{
+            render::instance_format::translate_scale};
+        // Program, uses instancing;
+        // called to draw the box; packed rigid instances
+        DrawInstancedWithTexture ballDraw_{render::instance_format::packed};
+
+        // Ball boxes, one per skin
         render::Box ballObject_[3];
-        // Map item
-        render::Box wallObject_;
+        // Ground, grid and wall, in chunks
+        std::unique_ptr<ChunkMap> map_;
 
         // Box skins
         std::vector<unsigned> textureHandles_;
@@ -1,6 +1,10 @@
 #include "program.hpp"
+#include "gl_state.hpp"
 #include "glad/glad.h"
+#include <algorithm>
 #include <cstring>
+#include <string>
+#include <vector>
 
 Program::ProgramBuildException::ProgramBuildException(int programHandle)
 {
@@ -43,7 +47,7 @@ Program::Program()
 
 void Program::use()
 {
-    glUseProgram(programHandle_);
+    render::state::use_program(programHandle_);
 }
 
 void Program::link()
@@ -57,43 +61,130 @@ void Program::link()
     if (ret == GL_FALSE) {
         throw Program::ProgramBuildException(programHandle_);
     }
+
+    // Resolve uniform locations once
+    int count = 0;
+    int maxLength = 0;
+    glGetProgramiv(programHandle_, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(programHandle_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> name(maxLength + 1);
+    uniforms_.clear();
+
+    int i = 0;
+    for (; i != count; ++i) {
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(programHandle_,
+                           i,
+                           name.size(),
+                           &length,
+                           &size,
+                           &type,
+                           name.data());
+
+        // Uniform block members have no location
+        const int loc = glGetUniformLocation(programHandle_, name.data());
+        if (loc == -1)
+            continue;
+
+        // Arrays are listed as "name[0]"; register them as "name" too
+        std::string key(name.data(), length);
+        if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0)
+            uniforms_.emplace_back(key.substr(0, key.size() - 3), loc);
+        uniforms_.emplace_back(std::move(key), loc);
+    }
+
+    std::sort(uniforms_.begin(), uniforms_.end());
+}
+
+void Program::bind_uniform_block(const char* name, unsigned binding)
+{
+    const unsigned index = glGetUniformBlockIndex(programHandle_, name);
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(programHandle_, index, binding);
+}
+
+int Program::location(const char* name) const
+{
+    auto it = std::lower_bound(
+        uniforms_.begin(),
+        uniforms_.end(),
+        name,
+        [](const std::pair<std::string, int>& lhs, const char* rhs) {
+            return lhs.first.compare(rhs) < 0;
+        });
+    if (it != uniforms_.end() && it->first.compare(name) == 0)
+        return it->second;
+
+    // Other array elements, or a name that is not active
+    return glGetUniformLocation(programHandle_, name);
+}
+
+void Program::upload(int location, int, const int* value)
+{
+    glUniform1i(location, *value);
+}
+
+void Program::upload(int location, float, const float* value)
+{
+    glUniform1f(location, *value);
+}
+
+void Program::upload(int location, uniform::vec3, const float* value)
+{
+    glUniform3fv(location, 1, value);
+}
+
+void Program::upload(int location, uniform::vec4, const float* value)
+{
+    glUniform4fv(location, 1, value);
+}
+
+void Program::upload(int location, uniform::mat3, const float* value)
+{
+    glUniformMatrix3fv(location, 1, GL_FALSE, value);
+}
+
+void Program::upload(int location, uniform::mat4, const float* value)
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
 }
 
 void Program::set_value(const char* name, const bool value)
 {
-    glUniform1i(glGetUniformLocation(programHandle_, name), value);
+    glUniform1i(location(name), value);
 }
 
 void Program::set_value(const char* name, const int value)
 {
-    glUniform1i(glGetUniformLocation(programHandle_, name), value);
+    glUniform1i(location(name), value);
 }
 
 void Program::set_value(const char* name, const float value)
 {
-    glUniform1f(glGetUniformLocation(programHandle_, name), value);
+    glUniform1f(location(name), value);
 }
 
 void Program::set_value_vec3(const char* name, const float* value)
 {
-    glUniform3fv(glGetUniformLocation(programHandle_, name), 1, value);
+    glUniform3fv(location(name), 1, value);
 }
 
 void Program::set_value_mat3x3(const char* name, const float* value)
 {
-    glUniformMatrix3fv(
-        glGetUniformLocation(programHandle_, name), 1, GL_FALSE, value);
+    glUniformMatrix3fv(location(name), 1, GL_FALSE, value);
 }
 
 void Program::set_value_vec4(const char* name, const float* value)
 {
-    glUniform4fv(glGetUniformLocation(programHandle_, name), 1, value);
+    glUniform4fv(location(name), 1, value);
 }
 
 void Program::set_value_mat4x4(const char* name, const float* value)
 {
-    glUniformMatrix4fv(
-        glGetUniformLocation(programHandle_, name), 1, GL_FALSE, value);
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, value);
 }
 
 namespace {
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
 
 //! struct vertex_shader
 /*! Vertex shader source code
@@ -16,6 +20,74 @@ struct fragment_shader {
     const char* src;
 };
 
+//! namespace uniform
+/*! Uniform types for UniformHandle, besides int and float
+ */
+namespace uniform {
+    struct vec3 {};
+    struct vec4 {};
+    struct mat3 {};
+    struct mat4 {};
+} // namespace uniform
+
+//! struct uniform_traits
+/*! Element type and # of elements of a uniform type
+ */
+template <typename T>
+struct uniform_traits {
+    typedef T value_type;
+    static constexpr unsigned kSize = 1;
+};
+
+template <>
+struct uniform_traits<uniform::vec3> {
+    typedef float value_type;
+    static constexpr unsigned kSize = 3;
+};
+
+template <>
+struct uniform_traits<uniform::vec4> {
+    typedef float value_type;
+    static constexpr unsigned kSize = 4;
+};
+
+template <>
+struct uniform_traits<uniform::mat3> {
+    typedef float value_type;
+    static constexpr unsigned kSize = 9;
+};
+
+template <>
+struct uniform_traits<uniform::mat4> {
+    typedef float value_type;
+    static constexpr unsigned kSize = 16;
+};
+
+//! class UniformHandle
+/*! Uniform location resolved once, plus the value last uploaded through
+ *! the handle; setting an unchanged value again uploads nothing. Values set
+ *! by name go around the cache, so set each uniform one way only
+ */
+template <typename T>
+class UniformHandle {
+public:
+    //! @return
+    //!     Whether the program uses the uniform
+    bool valid() const
+    {
+        return location_ != -1;
+    }
+private:
+    friend class Program;
+
+    // Location; -1 when the uniform is unused
+    int location_ = -1;
+    // Whether value_ holds the last upload
+    bool cached_ = false;
+    // Last uploaded value
+    typename uniform_traits<T>::value_type value_[uniform_traits<T>::kSize];
+};
+
 //! class program
 /*! Encapsulates an OpenGL program
  */
@@ -40,9 +112,47 @@ public:
     //! Sets program to be used by subsequent calls
     void use();
 
-    //! Links program (use during creation phase)
+    //! @return
+    //!     GL program name
+    int get_handle() const
+    {
+        return programHandle_;
+    }
+
+    //! Links program (use during creation phase); resolves the locations
+    //! of all active uniforms
     void link();
 
+    //! Attaches uniform block `name` to uniform buffer binding point
+    //! `binding`; call after link()
+    void bind_uniform_block(const char* name, unsigned binding);
+
+    //! @return
+    //!     Handle to uniform `name`; call after link()
+    template <typename T>
+    UniformHandle<T> get_uniform(const char* name) const
+    {
+        UniformHandle<T> out;
+        out.location_ = location(name);
+        return out;
+    }
+
+    //! Uploads `value` unless it equals the last value set through
+    //! `handle`; the program must be in use
+    template <typename T>
+    void set_value(UniformHandle<T>& handle,
+                   const typename uniform_traits<T>::value_type* value)
+    {
+        constexpr unsigned n = uniform_traits<T>::kSize;
+        if (handle.location_ == -1
+            || (handle.cached_ && std::equal(value, value + n, handle.value_)))
+            return;
+
+        std::copy_n(value, n, handle.value_);
+        handle.cached_ = true;
+        upload(handle.location_, T(), value);
+    }
+
     //! @set
     void set_value(const char* name, const bool value);
 
@@ -87,6 +197,23 @@ public:
 private:
     // Handle to shader program
     int programHandle_;
+    // Active uniforms and their locations, sorted by name
+    std::vector<std::pair<std::string, int>> uniforms_;
+
+    // Helper
+    // @return
+    //     Location of uniform `name`, -1 when unused; from the table built
+    //     by link() where possible
+    int location(const char* name) const;
+
+    // Helper
+    // Uploads one uniform of the given type to the program in use
+    static void upload(int location, int, const int* value);
+    static void upload(int location, float, const float* value);
+    static void upload(int location, uniform::vec3, const float* value);
+    static void upload(int location, uniform::vec4, const float* value);
+    static void upload(int location, uniform::mat3, const float* value);
+    static void upload(int location, uniform::mat4, const float* value);
 
     // Helper
     // @param
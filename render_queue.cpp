@@ -0,0 +1,85 @@
+#include "render_queue.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    // Helper
+    // @return
+    //     16-bit bucket increasing with `depth`; the top bits of a positive
+    //     float order like the float itself, with finer buckets up close
+    std::uint64_t depth_bucket(float depth)
+    {
+        if (!(depth > 0))
+            return 0;
+
+        std::uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 15;
+    }
+
+    // Helper
+    // Stable LSD radix sort by key, one byte per pass; passes where every
+    // key has the same byte are skipped
+    void radix_sort(std::vector<render::packet>& packets,
+                    std::vector<render::packet>& scratch)
+    {
+        if (packets.size() < 2)
+            return;
+
+        scratch.resize(packets.size());
+
+        unsigned shift = 0;
+        for (; shift != 64; shift += 8) {
+            unsigned count[256] = {};
+            for (const render::packet& p : packets)
+                ++count[(p.key >> shift) & 0xff];
+
+            if (count[(packets[0].key >> shift) & 0xff] == packets.size())
+                continue;
+
+            unsigned offset = 0;
+            unsigned i = 0;
+            for (; i != 256; ++i) {
+                const unsigned n = count[i];
+                count[i] = offset;
+                offset += n;
+            }
+
+            for (const render::packet& p : packets)
+                scratch[count[(p.key >> shift) & 0xff]++] = p;
+
+            packets.swap(scratch);
+        }
+    }
+} // namespace
+
+void render::submit(queue& refqueue,
+                    const Drawable& refdrawable,
+                    Program& refprogram,
+                    float depth)
+{
+    const std::uint64_t program = refprogram.get_handle() & 0xffff;
+    const std::uint64_t vao = refdrawable.vertex_array() & 0xffff;
+    const std::uint64_t textures = refdrawable.texture_key() & 0xffff;
+
+    packet p;
+    p.key = program << 48 | textures << 32 | vao << 16 | depth_bucket(depth);
+    p.drawable = &refdrawable;
+    p.program = &refprogram;
+    refqueue.packets.push_back(p);
+}
+
+void render::flush(queue& refqueue)
+{
+    radix_sort(refqueue.packets, refqueue.scratch);
+
+    // Program binds between packets of one program are elided by the
+    // GL state cache
+    for (const packet& p : refqueue.packets) {
+        p.program->use();
+        p.drawable->draw();
+    }
+
+    refqueue.packets.clear();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "drawable.hpp"
+#include "program.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+    //! struct packet
+    /*! One draw call: a drawable and the program that draws it, with the
+     *! sort key built from their state
+     */
+    struct packet {
+        // Program, texture set, VAO and depth bucket, 16 bits each, most
+        // significant first
+        std::uint64_t key;
+        // Object to draw
+        const Drawable* drawable;
+        // Program to draw it with
+        Program* program;
+    };
+
+    //! struct queue
+    /*! Draw calls of one frame, sorted so that draws sharing a program,
+     *! then textures, then VAO, run back to back; within equal state,
+     *! opaque objects go front to back for early depth rejection
+     */
+    struct queue {
+        // Submitted packets; sorted by flush()
+        std::vector<packet> packets;
+        // Radix sort buffer, kept across frames
+        std::vector<packet> scratch;
+    };
+
+    /*! @brief Implementation.
+     *! Queues `refdrawable` for drawing with `refprogram`
+     *! @param depth
+     *!     View-space distance of the object; negative values count as 0
+     */
+    void submit(queue& refqueue,
+                const Drawable& refdrawable,
+                Program& refprogram,
+                float depth);
+
+    /*! @brief Implementation.
+     *! Sorts the packets, issues their draws and empties the queue
+     */
+    void flush(queue& refqueue);
+} // namespace render
@@ -0,0 +1,37 @@
+R"(
+#if INSTANCE_FORMAT == 0
+layout (location = INSTANCE_LOCATION) in mat4 aInst;
+
+vec4 instance_transform(vec3 p)
+{
+    return aInst * vec4(p, 1.0);
+}
+#elif INSTANCE_FORMAT == 1
+// Columns hold the top three rows of the model matrix
+layout (location = INSTANCE_LOCATION) in mat3x4 aInst;
+
+vec4 instance_transform(vec3 p)
+{
+    return vec4(vec4(p, 1.0) * aInst, 1.0);
+}
+#elif INSTANCE_FORMAT == 2
+// Translation in xyz, uniform scale in w
+layout (location = INSTANCE_LOCATION) in vec4 aInst;
+
+vec4 instance_transform(vec3 p)
+{
+    return vec4(p * aInst.w + aInst.xyz, 1.0);
+}
+#else
+// Column 0 as above, column 1 the rotation quaternion (x, y, z, w)
+layout (location = INSTANCE_LOCATION) in mat2x4 aInst;
+
+vec4 instance_transform(vec3 p)
+{
+    vec4 q = normalize(aInst[1]);
+    vec3 v = p * aInst[0].w;
+    v += 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+    return vec4(v + aInst[0].xyz, 1.0);
+}
+#endif
+)"
@@ -1,18 +1,19 @@
 R"(
-#version 330 core
-
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
-layout (location = 2) in mat4 aInst;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
 
 out vec2 TexCoord;
 
 void main()
 {
-    gl_Position = projection * view * aInst * vec4(aPos, 1.0);
+    gl_Position = viewProjection * instance_transform(aPos);
     TexCoord = vec2(aTexCoord.x, aTexCoord.y);
 }
 )"
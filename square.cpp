@@ -1,11 +1,12 @@
 #include "square.hpp"
+#include "gl_state.hpp"
 #include "glad/glad.h"
 #include "texture.hpp"
 #include <cstring>
 
 namespace {
     // Render::Square shape and texture vertices
-    const float kVertices[] = {
+    constexpr float kVertices[] = {
         -0.5F, -0.5F, 0.0F, 0.0F, 0.0F, +0.5F, -0.5F, 0.0F, 1.0F, 0.0F,
         +0.5F, 0.5F,  0.0F, 1.0F, 1.0F, +0.5F, 0.5F,  0.0F, 1.0F, 1.0F,
         -0.5F, 0.5F,  0.0F, 0.0F, 1.0F, -0.5F, -0.5F, 0.0F, 0.0F, 0.0F,
@@ -14,20 +15,21 @@ namespace {
 
 render::Square::Square(const unsigned* taoSrc,
                        unsigned taoCount,
-                       unsigned instanceSizeMax)
+                       unsigned instanceSizeMax,
+                       instance_format format)
 {
     std::memset(&tao_, 0, sizeof(tao_));
-    std::memset(&vbo_, 0, sizeof(vbo_));
+    render::init(vbo_, instanceSizeMax, 2, format);
 
     // Copy texture handles
     std::memcpy(tao_.tao, taoSrc, (tao_.size = taoCount) * sizeof(unsigned));
 
     // Initialize OpenGL buffers
     glGenVertexArrays(1, &vbo_.mesh);
-    glBindVertexArray(vbo_.mesh);
+    render::state::bind_vertex_array(vbo_.mesh);
 
     glGenBuffers(1, &vbo_.vertex);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_.vertex);
+    render::state::bind_buffer(GL_ARRAY_BUFFER, vbo_.vertex);
 
     // Add vertices
     glBufferData(GL_ARRAY_BUFFER, sizeof(kVertices), kVertices, GL_STATIC_DRAW);
@@ -45,66 +47,23 @@ render::Square::Square(const unsigned* taoSrc,
                           (void*)(3 * sizeof(float)));
 
     // Instancing
-    glGenBuffers(1, &vbo_.instance);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_.instance);
+    render::create_instances(vbo_);
 
-    // Null buffer
-    glBufferData(GL_ARRAY_BUFFER,
-                 instanceSizeMax * 16 * sizeof(float),
-                 nullptr,
-                 GL_STREAM_DRAW);
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(
-        2, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(0));
-
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3,
-                          4,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          16 * sizeof(float),
-                          (void*)(4 * sizeof(float)));
-
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4,
-                          4,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          16 * sizeof(float),
-                          (void*)(8 * sizeof(float)));
-
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5,
-                          4,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          16 * sizeof(float),
-                          (void*)(12 * sizeof(float)));
-
-    glVertexAttribDivisor(2, 1);
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    render::state::bind_buffer(GL_ARRAY_BUFFER, 0);
+    render::state::bind_vertex_array(0);
 }
 
 void render::Square::draw() const
 {
-    static const unsigned kVertexSize = sizeof(kVertices) / sizeof(float) / 5;
+    constexpr unsigned kVertexSize = sizeof(kVertices) / sizeof(float) / 5;
+    static_assert(kVertexSize * 5 * sizeof(float) == sizeof(kVertices));
 
     // Load textures...
-    glBindVertexArray(0);
-    glBindVertexArray(vbo_.mesh);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    render::state::bind_vertex_array(vbo_.mesh);
 
     unsigned i = 0;
-    for (; i != tao_.size; ++i) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, tao_.tao[i]);
-    }
+    for (; i != tao_.size; ++i)
+        render::state::bind_texture(i, tao_.tao[i]);
 
     // TODO(Sam)
     // glClear(GL_STENCIL_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -112,7 +71,9 @@ void render::Square::draw() const
     // glDisable(GL_STENCIL_TEST);
 
     // Draw...
-    glDrawArraysInstanced(GL_TRIANGLES, 0, kVertexSize, vbo_.instanceCount);
+    glDrawArraysInstanced(
+        GL_TRIANGLES, 0, kVertexSize, render::begin_draw(vbo_));
+    render::end_draw(vbo_);
 }
 
 void render::Square::modify(const float* mat, unsigned instanceIndex)
@@ -141,3 +102,43 @@ void render::Square::push_back(const float* mat, unsigned count)
 {
     render::push_back(vbo_, mat, count);
 }
+
+void render::Square::flush()
+{
+    render::flush(vbo_);
+}
+
+const float* render::Square::instance_data() const
+{
+    return vbo_.cpu.data.data();
+}
+
+unsigned render::Square::instance_count() const
+{
+    return vbo_.instanceCount;
+}
+
+void render::Square::reserve(unsigned count)
+{
+    render::reserve(vbo_, count);
+}
+
+render::instance_format render::Square::format() const
+{
+    return vbo_.format;
+}
+
+unsigned render::Square::vertex_array() const
+{
+    return vbo_.mesh;
+}
+
+unsigned render::Square::texture_key() const
+{
+    return render::texture_key(tao_);
+}
+
+void* render::Square::stream(unsigned count)
+{
+    return render::stream(vbo_, count);
+}
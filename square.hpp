@@ -14,10 +14,12 @@ namespace render {
         //! Ctor.
         //! @param taoSrc texture handle array
         //! @param taoCount taoSrc size
-        //! @param instanceSizeMax the maximum # of instances to allocate
+        //! @param instanceSizeMax the initial # of instances to allocate
+        //! @param format instance layout; must match the drawing program
         Square(const unsigned* taoSrc,
                unsigned taoCount,
-               unsigned instanceSizeMax);
+               unsigned instanceSizeMax,
+               instance_format format = instance_format::mat4);
 
         void draw() const override;
 
@@ -32,6 +34,22 @@ namespace render {
         void push_back(const float* mat) override;
 
         void push_back(const float* mat, unsigned count) override;
+
+        void flush() override;
+
+        const float* instance_data() const override;
+
+        unsigned instance_count() const override;
+
+        void reserve(unsigned count) override;
+
+        instance_format format() const override;
+
+        unsigned vertex_array() const override;
+
+        unsigned texture_key() const override;
+
+        void* stream(unsigned count) override;
     private:
         // Texture handles
         tao tao_;
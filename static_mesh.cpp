@@ -0,0 +1,409 @@
+#include "static_mesh.hpp"
+#include "gl_state.hpp"
+#include "glad/glad.h"
+#include "texture.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+
+namespace {
+
+    // Render::Square corners and texture coordinates, in the order of its
+    // two triangles
+    constexpr float kCorners[] = {
+        -0.5F, -0.5F, 0.0F, 0.0F, +0.5F, -0.5F, 1.0F, 0.0F,
+        +0.5F, 0.5F,  1.0F, 1.0F, +0.5F, 0.5F,  1.0F, 1.0F,
+        -0.5F, 0.5F,  0.0F, 1.0F, -0.5F, -0.5F, 0.0F, 0.0F,
+    };
+
+    // Column-major identity; the transform of the single instance
+    constexpr float kIdentity[] = {
+        1.0F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, 0.0F,
+        0.0F, 0.0F, 1.0F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F,
+    };
+
+    // Floats per baked vertex; position and texture coordinates
+    constexpr unsigned kVertexFloats = 5;
+
+    // Vertices per baked square or rectangle
+    constexpr unsigned kQuadVertices = sizeof(kCorners) / sizeof(float) / 4;
+
+    //! struct lattice
+    /*! Grid of squares sharing a scale and a plane; cell (row, col) spans
+     *! [x + col * scale, x + (col + 1) * scale] and likewise in y
+     */
+    struct lattice {
+        float scale, z, x, y;
+    };
+
+    //! struct cell
+    /*! Axis-aligned square on a lattice; ordered by lattice, then row,
+     *! then column
+     */
+    struct cell {
+        unsigned lattice;
+        int row, col;
+
+        bool operator<(const cell& rhs) const
+        {
+            return std::tie(lattice, row, col)
+                   < std::tie(rhs.lattice, rhs.row, rhs.col);
+        }
+
+        bool operator==(const cell& rhs) const
+        {
+            return lattice == rhs.lattice && row == rhs.row && col == rhs.col;
+        }
+    };
+
+    //! struct rectangle
+    /*! Run of columns [first, last] over rows [top, bottom], still open
+     *! while rows are merged; ordered by run
+     */
+    struct rectangle {
+        int first, last, top, bottom;
+
+        bool operator<(const rectangle& rhs) const
+        {
+            return std::tie(first, last) < std::tie(rhs.first, rhs.last);
+        }
+    };
+
+    //! struct bake_scratch
+    /*! Grow-only working memory of StaticMesh::bake(); one instance per
+     *! thread, so rebaking never touches the allocator once warmed up
+     */
+    struct bake_scratch {
+        std::vector<float> vertices;
+        std::vector<lattice> lattices;
+        std::vector<cell> cells;
+        std::vector<rectangle> open;
+
+        //! @return
+        //!     Scratch owned by the calling thread, emptied
+        static bake_scratch& local()
+        {
+            thread_local bake_scratch scratch;
+            scratch.vertices.clear();
+            scratch.lattices.clear();
+            scratch.cells.clear();
+            scratch.open.clear();
+            return scratch;
+        }
+    };
+
+    // Helper
+    // Appends one quad spanning (x0, y0) - (x1, y1) at height z, with
+    // texture coordinates (0, 0) - (u, v)
+    void emit_rectangle(std::vector<float>& out,
+                        float x0,
+                        float y0,
+                        float x1,
+                        float y1,
+                        float z,
+                        float u,
+                        float v)
+    {
+        unsigned i = 0;
+        for (; i != kQuadVertices; ++i) {
+            const float* corner = kCorners + i * 4;
+            const float vertex[kVertexFloats]
+                = {corner[0] < 0 ? x0 : x1,
+                   corner[1] < 0 ? y0 : y1,
+                   z,
+                   corner[2] * u,
+                   corner[3] * v};
+            out.insert(out.end(), vertex, vertex + kVertexFloats);
+        }
+    }
+
+    // Helper
+    // Appends the square transformed by the column-major matrix `mat`
+    void emit_square(std::vector<float>& out, const float* mat)
+    {
+        unsigned i = 0;
+        for (; i != kQuadVertices; ++i) {
+            const float* corner = kCorners + i * 4;
+            const float vertex[kVertexFloats]
+                = {mat[0] * corner[0] + mat[4] * corner[1] + mat[12],
+                   mat[1] * corner[0] + mat[5] * corner[1] + mat[13],
+                   mat[2] * corner[0] + mat[6] * corner[1] + mat[14],
+                   corner[2],
+                   corner[3]};
+            out.insert(out.end(), vertex, vertex + kVertexFloats);
+        }
+    }
+
+    // Helper
+    // @return whether `mat` only translates and uniformly scales the
+    //     square, keeping it axis-aligned in its plane
+    bool axis_aligned(const float* mat)
+    {
+        return mat[0] > 0 && mat[0] == mat[5] && mat[1] == 0 && mat[2] == 0
+               && mat[4] == 0 && mat[6] == 0 && mat[3] == 0 && mat[7] == 0
+               && mat[15] == 1;
+    }
+
+    // Helper
+    // @return the cell of the axis-aligned square `mat` on its lattice in
+    //     `lattices`, which is added if there is none
+    cell find_cell(std::vector<lattice>& lattices, const float* mat)
+    {
+        const float scale = mat[0];
+        const float x = mat[12] - scale / 2;
+        const float y = mat[13] - scale / 2;
+        const float z = mat[14];
+        const float eps = scale * 1e-4F;
+
+        unsigned i = 0;
+        for (; i != lattices.size(); ++i) {
+            const lattice& l = lattices[i];
+            if (l.scale != scale || l.z != z)
+                continue;
+
+            const float c = (x - l.x) / scale;
+            const float r = (y - l.y) / scale;
+            const int col = int(std::lround(c));
+            const int row = int(std::lround(r));
+            if (std::fabs(c - col) < eps && std::fabs(r - row) < eps)
+                return {i, row, col};
+        }
+
+        lattices.push_back({scale, z, x, y});
+        return {i, 0, 0};
+    }
+
+    // Helper
+    // Appends the sorted, distinct cells [first, last) of lattice `l`
+    // merged into rectangles: runs of adjacent cells in a row, stacked with
+    // identical runs in the rows above; `open` is left empty
+    void emit_lattice(std::vector<float>& out,
+                      const lattice& l,
+                      const cell* first,
+                      const cell* last,
+                      std::vector<rectangle>& open)
+    {
+        const auto close = [&](const rectangle& rect) {
+            emit_rectangle(out,
+                           l.x + rect.first * l.scale,
+                           l.y + rect.top * l.scale,
+                           l.x + (rect.last + 1) * l.scale,
+                           l.y + (rect.bottom + 1) * l.scale,
+                           l.z,
+                           float(rect.last - rect.first + 1),
+                           float(rect.bottom - rect.top + 1));
+        };
+
+        const cell* it = first;
+        while (it != last) {
+            const int row = it->row;
+            rectangle run = {it->col, it->col, row, row};
+            while (++it != last && it->row == row && it->col == run.last + 1)
+                ++run.last;
+
+            const auto pos = std::lower_bound(open.begin(), open.end(), run);
+            if (pos == open.end() || run < *pos) {
+                open.insert(pos, run);
+            } else if (pos->bottom == row - 1) {
+                pos->bottom = row;
+            } else {
+                close(*pos);
+                *pos = run;
+            }
+        }
+
+        for (const rectangle& rect : open)
+            close(rect);
+        open.clear();
+    }
+} // namespace
+
+render::StaticMesh::StaticMesh(const unsigned* taoSrc,
+                               unsigned taoCount,
+                               instance_format format)
+{
+    std::memset(&tao_, 0, sizeof(tao_));
+    render::init(vbo_, 1, 2, format);
+
+    // Copy texture handles; rectangles repeat them once per square
+    std::memcpy(tao_.tao, taoSrc, (tao_.size = taoCount) * sizeof(unsigned));
+
+    unsigned i = 0;
+    for (; i != tao_.size; ++i)
+        render::repeat_texture(tao_.tao[i]);
+
+    // Initialize OpenGL buffers
+    glGenVertexArrays(1, &vbo_.mesh);
+    render::state::bind_vertex_array(vbo_.mesh);
+
+    glGenBuffers(1, &vbo_.vertex);
+    render::state::bind_buffer(GL_ARRAY_BUFFER, vbo_.vertex);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0,
+                          3,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          kVertexFloats * sizeof(float),
+                          (void*)(0));
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1,
+                          2,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          kVertexFloats * sizeof(float),
+                          (void*)(3 * sizeof(float)));
+
+    // The whole mesh is a single instance, already in world space
+    render::create_instances(vbo_);
+    render::push_back(vbo_, kIdentity);
+
+    render::state::bind_buffer(GL_ARRAY_BUFFER, 0);
+    render::state::bind_vertex_array(0);
+}
+
+void render::StaticMesh::bake() const
+{
+    bake_scratch& refscratch = bake_scratch::local();
+    std::vector<float>& vertices = refscratch.vertices;
+    std::vector<cell>& cells = refscratch.cells;
+
+    const unsigned count = instance_count();
+
+    unsigned i = 0;
+    for (; i != count; ++i) {
+        const float* mat = instances_.data() + i * 16;
+        if (!axis_aligned(mat))
+            emit_square(vertices, mat);
+        else
+            cells.push_back(find_cell(refscratch.lattices, mat));
+    }
+
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    // One lattice at a time, in the order they were found
+    const cell* first = cells.data();
+    const cell* end = first + cells.size();
+    while (first != end) {
+        const cell* last = first;
+        while (last != end && last->lattice == first->lattice)
+            ++last;
+
+        emit_lattice(vertices,
+                     refscratch.lattices[first->lattice],
+                     first,
+                     last,
+                     refscratch.open);
+        first = last;
+    }
+
+    render::state::bind_buffer(GL_ARRAY_BUFFER, vbo_.vertex);
+    glBufferData(GL_ARRAY_BUFFER,
+                 GLsizeiptr(vertices.size() * sizeof(float)),
+                 vertices.data(),
+                 GL_STATIC_DRAW);
+
+    vertexCount_ = vertices.size() / kVertexFloats;
+    dirty_ = false;
+}
+
+void render::StaticMesh::draw() const
+{
+    if (dirty_)
+        bake();
+
+    if (vertexCount_ == 0)
+        return;
+
+    // Load textures...
+    render::state::bind_vertex_array(vbo_.mesh);
+
+    unsigned i = 0;
+    for (; i != tao_.size; ++i)
+        render::state::bind_texture(i, tao_.tao[i]);
+
+    // Draw...
+    glDrawArraysInstanced(
+        GL_TRIANGLES, 0, vertexCount_, render::begin_draw(vbo_));
+    render::end_draw(vbo_);
+}
+
+void render::StaticMesh::modify(const float* mat, unsigned instanceIndex)
+{
+    /*ASSERT*/ assert(instanceIndex < instance_count());
+    std::memcpy(
+        instances_.data() + instanceIndex * 16, mat, 16 * sizeof(float));
+    dirty_ = true;
+}
+
+void render::StaticMesh::modify(const float* mat,
+                                const unsigned* instanceIndices,
+                                unsigned count)
+{
+    unsigned i = 0;
+    for (; i != count; ++i)
+        modify(mat + i * 16, instanceIndices[i]);
+}
+
+void render::StaticMesh::reset(const float* mat, unsigned count)
+{
+    instances_.assign(mat, mat + count * 16);
+    dirty_ = true;
+}
+
+void render::StaticMesh::push_back(const float* mat)
+{
+    push_back(mat, 1);
+}
+
+void render::StaticMesh::push_back(const float* mat, unsigned count)
+{
+    instances_.insert(instances_.end(), mat, mat + count * 16);
+    dirty_ = true;
+}
+
+void render::StaticMesh::flush()
+{
+    if (dirty_)
+        bake();
+}
+
+const float* render::StaticMesh::instance_data() const
+{
+    return instances_.data();
+}
+
+unsigned render::StaticMesh::instance_count() const
+{
+    return instances_.size() / 16;
+}
+
+void render::StaticMesh::reserve(unsigned count)
+{
+    instances_.reserve(std::size_t(count) * 16);
+}
+
+render::instance_format render::StaticMesh::format() const
+{
+    return vbo_.format;
+}
+
+unsigned render::StaticMesh::vertex_array() const
+{
+    return vbo_.mesh;
+}
+
+unsigned render::StaticMesh::texture_key() const
+{
+    return render::texture_key(tao_);
+}
+
+void* render::StaticMesh::stream(unsigned)
+{
+    /*ASSERT*/ assert(!"StaticMesh instances cannot be streamed");
+    return nullptr;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "drawable.hpp"
+#include <vector>
+
+namespace render {
+
+    //! class StaticMesh
+    /*! Textured squares baked into a single GL_STATIC_DRAW mesh, for tile
+     *! fields that never move. Takes the same instances as a Square, but
+     *! draws them all as one instance of the baked mesh: squares sharing a
+     *! uniform scale and a grid are merged into rectangles whose texture
+     *! coordinates repeat the texture once per square, the rest are baked
+     *! one by one.
+     */
+    class StaticMesh : public Drawable {
+    public:
+        //! Ctor.
+        StaticMesh() = default;
+
+        //! Ctor.
+        //! @param taoSrc
+        //!     Texture handle array; switched to GL_REPEAT wrapping
+        //! @param taoCount
+        //!     taoSrc size
+        //! @param format
+        //!     Instance layout on the GPU; must match the drawing program
+        StaticMesh(const unsigned* taoSrc,
+                   unsigned taoCount,
+                   instance_format format = instance_format::mat4);
+
+        void draw() const override;
+
+        void modify(const float* mat, unsigned instanceIndex) override;
+
+        void modify(const float* mat,
+                    const unsigned* instanceIndices,
+                    unsigned count) override;
+
+        void reset(const float* mat, unsigned count) override;
+
+        void push_back(const float* mat) override;
+
+        void push_back(const float* mat, unsigned count) override;
+
+        //! Rebakes the mesh if any instance changed since the last bake;
+        //! each write costs a whole rebuild, so keep them to load time
+        void flush() override;
+
+        const float* instance_data() const override;
+
+        unsigned instance_count() const override;
+
+        void reserve(unsigned count) override;
+
+        instance_format format() const override;
+
+        unsigned vertex_array() const override;
+
+        unsigned texture_key() const override;
+
+        //! Not supported; baked squares cannot be streamed
+        void* stream(unsigned count) override;
+    private:
+        //! Rebuilds the vertex buffer from instances_
+        void bake() const;
+
+        // Texture handles
+        tao tao_;
+        // Baked vertices in `vertex`, plus one identity instance
+        vbo vbo_;
+        // Column-major square matrices the mesh is baked from
+        std::vector<float> instances_;
+        // # of baked vertices
+        mutable unsigned vertexCount_ = 0;
+        // Whether instances_ changed since the last bake
+        mutable bool dirty_ = false;
+    };
+} // namespace render
@@ -1,4 +1,5 @@
 #include "texture.hpp"
+#include "gl_state.hpp"
 #include "glad/glad.h"
 #include "stb/stb_image.h"
 #include <cstdlib>
@@ -46,7 +47,7 @@ namespace {
         // Generate texture
         unsigned tao;
         glGenTextures(1, &tao);
-        glBindTexture(GL_TEXTURE_2D, tao);
+        render::state::bind_texture(0, tao);
 
         // Set the texture wrapping parameters
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -72,7 +73,7 @@ namespace {
                      t.data);
 
         glGenerateMipmap(GL_TEXTURE_2D);
-        return (glBindTexture(GL_TEXTURE_2D, 0), tao);
+        return (render::state::bind_texture(0, 0), tao);
     }
 } // namespace
 
@@ -111,3 +112,11 @@ unsigned render::load_texture_from_file(const char* path,
     return (stbi_image_free(data),
             generate_texture(t, alpha ? GL_RGBA : GL_RGB));
 }
+
+void render::repeat_texture(unsigned tao)
+{
+    render::state::bind_texture(0, tao);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    render::state::bind_texture(0, 0);
+}
@@ -17,4 +17,9 @@ namespace render {
     unsigned load_texture_from_file(const char* path,
                                     bool alpha,
                                     bool flipVertically = true);
+
+    /*! @brief Switches a loaded texture to GL_REPEAT wrapping, for
+     *! texture coordinates spanning several copies of the image
+     */
+    void repeat_texture(unsigned tao);
 } // namespace render